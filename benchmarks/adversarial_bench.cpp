@@ -0,0 +1,204 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <benchmark/benchmark.h>
+
+#include "mimesniff.h"
+
+// Inputs crafted to make a parser slow, with state.range(0) parameters or
+// bytes. The time per element must stay flat as they grow.
+
+static std::string many_parameters(size_t count) {
+  std::string input = "text/plain";
+  for (size_t i = 0; i < count; i++) {
+    input += ";p" + std::to_string(i) + "=" + std::to_string(i);
+  }
+  return input;
+}
+
+static std::string duplicate_parameters(size_t count) {
+  std::string input = "text/plain";
+  for (size_t i = 0; i < count; i++) {
+    input += i % 2 ? ";CHARSET=x" : ";charset=\"y\"";
+  }
+  return input;
+}
+
+static std::string long_quoted_value(size_t length) {
+  return "multipart/form-data;boundary=\"" + std::string(length, '-') + "\"";
+}
+
+static std::string many_backslashes(size_t length) {
+  std::string input = "text/plain;a=\"";
+  for (size_t i = 0; i < length / 2; i++) {
+    input += "\\\\";
+  }
+  return input + "\"";
+}
+
+template <std::string (*make_input)(size_t)>
+static void ParseBench(benchmark::State &state) {
+  std::string input = make_input(size_t(state.range(0)));
+  volatile size_t size = 0;
+  for (auto _ : state) {
+    auto mime = ada::mimesniff::parse_mime_type(input);
+    size += mime ? mime->serialized_size() : 0;
+  }
+  state.SetComplexityN(state.range(0));
+  state.SetBytesProcessed(int64_t(state.iterations() * input.size()));
+}
+
+template <std::string (*make_input)(size_t)>
+static void LazyBench(benchmark::State &state) {
+  std::string input = make_input(size_t(state.range(0)));
+  volatile size_t count = 0;
+  for (auto _ : state) {
+    auto mime = ada::mimesniff::parse_mime_type_lazy(input);
+    for (const auto &p : mime->parameters()) {
+      count += p.raw_value().size();
+    }
+  }
+  state.SetComplexityN(state.range(0));
+  state.SetBytesProcessed(int64_t(state.iterations() * input.size()));
+}
+
+template <std::string (*make_input)(size_t)>
+static void CanonicalizeBench(benchmark::State &state) {
+  std::string input = make_input(size_t(state.range(0)));
+  std::string buffer(2 * input.size() + 2, '\0');
+  volatile size_t size = 0;
+  for (auto _ : state) {
+    std::copy(input.begin(), input.end(), buffer.begin());
+    size += ada::mimesniff::canonicalize_in_place(buffer.data(), input.size(),
+                                                  buffer.size())
+                .value_or(0);
+  }
+  state.SetComplexityN(state.range(0));
+  state.SetBytesProcessed(int64_t(state.iterations() * input.size()));
+}
+
+// Resource headers crafted to make the media parsers walk as far as they can,
+// with state.range(0) bytes. Only the first resource_header_size bytes are
+// sniffed, so the time per header must stay flat whatever the size.
+
+static std::string mp4_without_brand(size_t length) {
+  // A box as large as the input, whose brands are all "isom".
+  std::string input(length & ~size_t(3), '\0');
+  uint32_t box_size = uint32_t(input.size());
+  for (size_t i = 0; i < 4; i++) {
+    input[i] = char(box_size >> (24 - 8 * i));
+  }
+  input.replace(4, 4, "ftyp");
+  for (size_t i = 8; i + 4 <= input.size(); i += 4) {
+    input.replace(i, 4, "isom");
+  }
+  return input;
+}
+
+static std::string webm_doctypes(size_t length) {
+  // DocType elements all over the first 38 bytes, then zeroes that look like
+  // the padding of a DocType up to the end.
+  std::string input = "\x1A\x45\xDF\xA3";
+  while (input.size() < 38) {
+    input += "\x42\x82\x80";
+  }
+  input.resize(std::max(length, input.size()), '\0');
+  return input;
+}
+
+static std::string mp3_frames(size_t length) {
+  // Frame headers everywhere: the first frame is 417 bytes long.
+  std::string input;
+  while (input.size() < length) {
+    input += "\xFF\xFB\x90\x64";
+  }
+  return input;
+}
+
+// Random bytes after the signatures the sniffer starts from, with random
+// bytes of each signature flipped, to reach the branches no crafted input
+// does.
+static std::vector<std::string> fuzzed_headers(size_t length) {
+  const std::string seeds[] = {mp4_without_brand(64),
+                               webm_doctypes(64),
+                               mp3_frames(64),
+                               std::string("RIFF\0\0\0\0WEBPVP8 ", 16),
+                               "<!DOCTYPE HTML>",
+                               "\x89PNG\r\n\x1A\n"};
+  std::vector<std::string> headers;
+  uint32_t seed = 42;
+  auto next = [&seed] {
+    seed = seed * 1103515245 + 12345;
+    return uint8_t(seed >> 16);
+  };
+  for (size_t copy = 0; copy < 64; copy++) {
+    for (const std::string &signature : seeds) {
+      std::string header(std::max(length, signature.size()), '\0');
+      for (char &c : header) {
+        c = char(next());
+      }
+      header.replace(0, signature.size(), signature);
+      header[next() % signature.size()] = char(next());
+      headers.push_back(std::move(header));
+    }
+  }
+  return headers;
+}
+
+template <std::string (*make_input)(size_t)>
+static void SniffBench(benchmark::State &state) {
+  std::string input = make_input(size_t(state.range(0)));
+  volatile size_t sum = 0;
+  for (auto _ : state) {
+    sum += size_t(ada::mimesniff::identify_unknown_mime_type(input, true));
+  }
+  state.SetComplexityN(state.range(0));
+}
+
+static void FuzzedSniffBench(benchmark::State &state) {
+  std::vector<std::string> headers = fuzzed_headers(size_t(state.range(0)));
+  volatile size_t sum = 0;
+  for (auto _ : state) {
+    for (const std::string &header : headers) {
+      sum += size_t(ada::mimesniff::identify_unknown_mime_type(header, true));
+    }
+  }
+  state.SetComplexityN(state.range(0));
+  state.SetItemsProcessed(int64_t(state.iterations() * headers.size()));
+}
+
+#define ADVERSARIAL_BENCHMARK(bench, input, max)                   \
+  BENCHMARK_TEMPLATE(bench, input)                                 \
+      ->Name(#bench "/" #input)                                    \
+      ->RangeMultiplier(4)                                         \
+      ->Range(16, max)                                             \
+      ->Complexity(benchmark::oN)
+
+ADVERSARIAL_BENCHMARK(ParseBench, many_parameters, 16384);
+ADVERSARIAL_BENCHMARK(ParseBench, duplicate_parameters, 16384);
+ADVERSARIAL_BENCHMARK(ParseBench, long_quoted_value, 1 << 20);
+ADVERSARIAL_BENCHMARK(ParseBench, many_backslashes, 1 << 20);
+ADVERSARIAL_BENCHMARK(LazyBench, many_parameters, 16384);
+ADVERSARIAL_BENCHMARK(LazyBench, duplicate_parameters, 16384);
+ADVERSARIAL_BENCHMARK(CanonicalizeBench, many_parameters, 16384);
+ADVERSARIAL_BENCHMARK(CanonicalizeBench, duplicate_parameters, 16384);
+
+
+#define SNIFF_BENCHMARK(bench, input)                              \
+  BENCHMARK_TEMPLATE(bench, input)                                 \
+      ->Name(#bench "/" #input)                                    \
+      ->RangeMultiplier(4)                                         \
+      ->Range(16, 1 << 20)                                         \
+      ->Complexity(benchmark::o1)
+
+SNIFF_BENCHMARK(SniffBench, mp4_without_brand);
+SNIFF_BENCHMARK(SniffBench, webm_doctypes);
+SNIFF_BENCHMARK(SniffBench, mp3_frames);
+BENCHMARK(FuzzedSniffBench)
+    ->RangeMultiplier(4)
+    ->Range(16, 1 << 20)
+    ->Complexity(benchmark::o1);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,275 @@
+#include <cstdlib>
+#include <iostream>
+#include <filesystem>
+#include <memory_resource>
+#include <new>
+#include <benchmark/benchmark.h>
+
+#include "mimesniff.h"
+#include "simdjson.h"
+
+using namespace simdjson;
+
+// Every allocation made by the process goes through these counters so that
+// the benchmarks can report how much heap memory a parsed record costs.
+size_t allocation_count = 0;
+size_t allocation_bytes = 0;
+
+void *operator new(size_t size) {
+  allocation_count++;
+  allocation_bytes += size;
+  if (void *p = std::malloc(size == 0 ? 1 : size)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+
+bool file_exists(const char *filename) {
+  namespace fs = std::filesystem;
+  std::filesystem::path f{filename};
+  if (std::filesystem::exists(filename)) {
+    return true;
+  } else {
+    return false;
+  }
+}
+
+double mime_examples_bytes{};
+
+std::vector<std::string> mime_examples;
+
+size_t init_data(const char *source) {
+  ondemand::parser parser;
+
+  if (!file_exists(source)) {
+    return 0;
+  }
+  padded_string json = padded_string::load(source);
+  ondemand::document doc = parser.iterate(json);
+  for (auto element : doc.get_array()) {
+    if (element.type() == ondemand::json_type::object) {
+      std::string_view input;
+      if (element["input"].get_string(true).get(input) != simdjson::SUCCESS) {
+        printf("missing input.\n");
+      }
+      mime_examples.push_back(std::string(input));
+      mime_examples_bytes += input.size();
+    }
+  }
+  return mime_examples.size();
+}
+
+// The layout of ada::mimesniff::mimetype before it was made compact: two
+// strings and a vector of string pairs.
+struct legacy_mimetype {
+  std::string type{};
+  std::string subtype{};
+  std::vector<std::pair<std::string, std::string>> parameters{};
+};
+
+struct legacy_mimetype_builder {
+  legacy_mimetype &out;
+
+  void on_essence(std::string_view type, uint8_t type_map,
+                  std::string_view subtype, uint8_t subtype_map) {
+    out.type = type;
+    out.subtype = subtype;
+    if (type_map & 4) {
+      ada::mimesniff::to_lower_ascii(out.type.data(), out.type.size());
+    }
+    if (subtype_map & 4) {
+      ada::mimesniff::to_lower_ascii(out.subtype.data(), out.subtype.size());
+    }
+    out.parameters.reserve(2);
+  }
+
+  void on_parameter(std::string_view name, uint8_t, std::string_view value,
+                    bool escaped) {
+    std::string parameter_name(name);
+    ada::mimesniff::to_lower_ascii_short(parameter_name.data(),
+                                         parameter_name.size());
+    std::string parameter_value(value);
+    if (escaped) {
+      parameter_value.resize(ada::mimesniff::unescape_http_quoted_string(
+          value, parameter_value.data()));
+    }
+    if (ada::mimesniff::contains_only_http_quoted_string_tokens(
+            parameter_value) &&
+        std::none_of(out.parameters.begin(), out.parameters.end(),
+                     [&parameter_name](auto &param) {
+                       return param.first == parameter_name;
+                     })) {
+      out.parameters.emplace_back(parameter_name, parameter_value);
+    }
+  }
+};
+
+std::optional<legacy_mimetype> legacy_parse_mime_type(std::string_view input) {
+  legacy_mimetype out{};
+  legacy_mimetype_builder builder{out};
+  if (!ada::mimesniff::parse_mime_type_components(input, builder)) {
+    return std::nullopt;
+  }
+  return out;
+}
+
+// Parses every example, keeping the records alive like a metadata store
+// would, and reports the memory they use next to the parsing speed.
+template <typename record, typename parse_function>
+void layout_bench(benchmark::State &state, parse_function parse) {
+  std::vector<record> records;
+  records.reserve(mime_examples.size());
+  size_t count_before = allocation_count;
+  size_t bytes_before = allocation_bytes;
+  for (const std::string &input : mime_examples) {
+    auto mime = parse(input);
+    if (mime) {
+      records.push_back(std::move(*mime));
+    }
+  }
+  double allocations = double(allocation_count - count_before);
+  double heap_bytes = double(allocation_bytes - bytes_before);
+  double valid = double(records.size());
+
+  volatile size_t record_count = 0;
+  for (auto _ : state) {
+    records.clear();
+    for (const std::string &input : mime_examples) {
+      auto mime = parse(input);
+      if (mime) {
+        records.push_back(std::move(*mime));
+      }
+    }
+    record_count += records.size();
+  }
+
+  state.counters["allocations/record"] = allocations / valid;
+  state.counters["heap bytes/record"] = heap_bytes / valid;
+  state.counters["inline bytes/record"] = double(sizeof(record));
+  state.counters["bytes/record"] = double(sizeof(record)) + heap_bytes / valid;
+  state.counters["mime/s"] =
+      benchmark::Counter(double(std::size(mime_examples)),
+                         benchmark::Counter::kIsIterationInvariantRate);
+  state.counters["speed"] = benchmark::Counter(
+      mime_examples_bytes, benchmark::Counter::kIsIterationInvariantRate);
+}
+
+static void LegacyLayout(benchmark::State &state) {
+  layout_bench<legacy_mimetype>(state, legacy_parse_mime_type);
+}
+BENCHMARK(LegacyLayout);
+
+static void CompactLayout(benchmark::State &state) {
+  layout_bench<ada::mimesniff::mimetype>(state, [](std::string_view input) {
+    return ada::mimesniff::parse_mime_type(input);
+  });
+}
+BENCHMARK(CompactLayout);
+
+// Same as CompactLayout but every record is allocated from a per-batch arena
+// that is released all at once, as a request pipeline would do.
+static void CompactLayoutArena(benchmark::State &state) {
+  std::vector<char> arena(64 * 1024 + size_t(mime_examples_bytes) * 2);
+  std::pmr::monotonic_buffer_resource resource(arena.data(), arena.size());
+  std::vector<ada::mimesniff::pmr::mimetype> records;
+  records.reserve(mime_examples.size());
+  size_t count_before = allocation_count;
+  for (const std::string &input : mime_examples) {
+    auto mime = ada::mimesniff::parse_mime_type(input, &resource);
+    if (mime) {
+      records.push_back(std::move(*mime));
+    }
+  }
+  double allocations = double(allocation_count - count_before);
+  double valid = double(records.size());
+
+  volatile size_t record_count = 0;
+  for (auto _ : state) {
+    records.clear();
+    resource.release();
+    for (const std::string &input : mime_examples) {
+      auto mime = ada::mimesniff::parse_mime_type(input, &resource);
+      if (mime) {
+        records.push_back(std::move(*mime));
+      }
+    }
+    record_count += records.size();
+  }
+
+  state.counters["allocations/record"] = allocations / valid;
+  state.counters["inline bytes/record"] =
+      double(sizeof(ada::mimesniff::pmr::mimetype));
+  state.counters["mime/s"] =
+      benchmark::Counter(double(std::size(mime_examples)),
+                         benchmark::Counter::kIsIterationInvariantRate);
+  state.counters["speed"] = benchmark::Counter(
+      mime_examples_bytes, benchmark::Counter::kIsIterationInvariantRate);
+}
+BENCHMARK(CompactLayoutArena);
+
+// Counts the allocations made while parsing the corpus over and over, after a
+// warm-up pass, with a fresh record per call and with reused records.
+template <typename parse_function>
+void steady_state_bench(benchmark::State &state, parse_function parse) {
+  volatile size_t mime_size = 0;
+  for (const std::string &input : mime_examples) {
+    mime_size += parse(input);
+  }
+  size_t count_before = allocation_count;
+  size_t iterations = 0;
+  for (auto _ : state) {
+    for (const std::string &input : mime_examples) {
+      mime_size += parse(input);
+    }
+    iterations++;
+  }
+  state.counters["allocations/mime"] =
+      double(allocation_count - count_before) /
+      double(iterations * mime_examples.size());
+  state.counters["mime/s"] =
+      benchmark::Counter(double(std::size(mime_examples)),
+                         benchmark::Counter::kIsIterationInvariantRate);
+}
+
+static void SteadyStateParse(benchmark::State &state) {
+  steady_state_bench(state, [](std::string_view input) -> size_t {
+    auto mime = ada::mimesniff::parse_mime_type(input);
+    return mime ? mime->essence().size() : 0;
+  });
+}
+BENCHMARK(SteadyStateParse);
+
+static void SteadyStateParseInto(benchmark::State &state) {
+  ada::mimesniff::mimetype mime;
+  steady_state_bench(state, [&mime](std::string_view input) -> size_t {
+    return ada::mimesniff::parse_mime_type_into(mime, input)
+               ? mime.essence().size()
+               : 0;
+  });
+}
+BENCHMARK(SteadyStateParseInto);
+
+static void SteadyStateThreadLocalParser(benchmark::State &state) {
+  steady_state_bench(state, [](std::string_view input) -> size_t {
+    auto mime = ada::mimesniff::parser::thread_local_instance().parse(input);
+    return mime ? mime->essence().size() : 0;
+  });
+}
+BENCHMARK(SteadyStateThreadLocalParser);
+
+int main(int argc, char **argv) {
+  if (argc == 1 || !init_data(argv[1])) {
+    std::cout << "pass the path to the file wpt/generated-mime-types.json as a "
+                 "parameter."
+              << std::endl;
+    std::cout << "E.g., './build/benchmarks/memory_bench "
+                 "wpt/generated-mime-types.json'"
+              << std::endl;
+    return EXIT_SUCCESS;
+  }
+  benchmark::Initialize(&argc, argv);
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+}
@@ -0,0 +1,119 @@
+#include <cstdlib>
+#include <iostream>
+#include <filesystem>
+#include <thread>
+#include <benchmark/benchmark.h>
+
+#include "mimesniff.h"
+#include "simdjson.h"
+
+using namespace simdjson;
+
+bool file_exists(const char *filename) {
+  namespace fs = std::filesystem;
+  std::filesystem::path f{filename};
+  if (std::filesystem::exists(filename)) {
+    return true;
+  } else {
+    return false;
+  }
+}
+
+double mime_examples_bytes{};
+
+std::vector<std::string> mime_examples;
+// The corpus repeated until it is large enough to keep every thread busy,
+// as when re-validating every object of a bucket.
+std::vector<std::string_view> inputs;
+constexpr size_t input_count = 1 << 18;
+
+size_t init_data(const char *source) {
+  ondemand::parser parser;
+
+  if (!file_exists(source)) {
+    return 0;
+  }
+  padded_string json = padded_string::load(source);
+  ondemand::document doc = parser.iterate(json);
+  for (auto element : doc.get_array()) {
+    if (element.type() == ondemand::json_type::object) {
+      std::string_view input;
+      if (element["input"].get_string(true).get(input) != simdjson::SUCCESS) {
+        printf("missing input.\n");
+      }
+      mime_examples.push_back(std::string(input));
+    }
+  }
+  if (mime_examples.empty()) {
+    return 0;
+  }
+  while (inputs.size() < input_count) {
+    const std::string &input =
+        mime_examples[inputs.size() % mime_examples.size()];
+    inputs.push_back(input);
+    mime_examples_bytes += input.size();
+  }
+  return inputs.size();
+}
+
+void set_counters(benchmark::State &state) {
+  state.counters["mime/s"] = benchmark::Counter(
+      double(inputs.size()), benchmark::Counter::kIsIterationInvariantRate);
+  state.counters["speed"] = benchmark::Counter(
+      mime_examples_bytes, benchmark::Counter::kIsIterationInvariantRate);
+}
+
+// The records are reused from one iteration to the next, so the threads
+// never go to the global allocator once they are warm.
+static void ParallelParseInto(benchmark::State &state) {
+  ada::mimesniff::thread_pool pool(size_t(state.range(0)));
+  std::vector<ada::mimesniff::mimetype> results(inputs.size());
+  std::vector<uint64_t> valid((inputs.size() + 63) / 64);
+  volatile size_t valid_count = 0;
+  for (auto _ : state) {
+    valid_count += ada::mimesniff::parse_mime_types_parallel(
+        inputs.data(), inputs.size(), results.data(), valid.data(), pool);
+  }
+  set_counters(state);
+}
+
+// Fresh records on every iteration: every valid input costs an allocation,
+// which shows how much the global allocator limits the scaling.
+static void ParallelParseFresh(benchmark::State &state) {
+  ada::mimesniff::thread_pool pool(size_t(state.range(0)));
+  std::vector<uint64_t> valid((inputs.size() + 63) / 64);
+  volatile size_t valid_count = 0;
+  for (auto _ : state) {
+    std::vector<ada::mimesniff::mimetype> results(inputs.size());
+    valid_count += ada::mimesniff::parse_mime_types_parallel(
+        inputs.data(), inputs.size(), results.data(), valid.data(), pool);
+  }
+  set_counters(state);
+}
+
+int main(int argc, char **argv) {
+  if (argc == 1 || !init_data(argv[1])) {
+    std::cout << "pass the path to the file wpt/generated-mime-types.json as a "
+                 "parameter."
+              << std::endl;
+    std::cout << "E.g., './build/benchmarks/parallel_bench "
+                 "wpt/generated-mime-types.json'"
+              << std::endl;
+    return EXIT_SUCCESS;
+  }
+  int max_threads = int(ada::mimesniff::thread_pool::default_thread_count());
+  using bench_function = void (*)(benchmark::State &);
+  for (auto [name, bench] :
+       {std::make_pair("ParallelParseInto", bench_function(ParallelParseInto)),
+        std::make_pair("ParallelParseFresh",
+                       bench_function(ParallelParseFresh))}) {
+    benchmark::RegisterBenchmark(name, bench)
+        ->DenseRange(1, max_threads, 1)
+        ->ArgName("threads")
+        ->UseRealTime()
+        ->Unit(benchmark::kMillisecond);
+  }
+  benchmark::Initialize(&argc, argv);
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+}
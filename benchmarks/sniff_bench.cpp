@@ -0,0 +1,353 @@
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <benchmark/benchmark.h>
+
+#include "mimesniff.h"
+
+using namespace std::string_view_literals;
+using ada::mimesniff::essence_id;
+
+// Resource headers of the common kinds, each followed by filler up to a
+// typical first packet. Binary formats get binary filler, so that no header
+// can be told apart by its size or its tail.
+static std::vector<std::string> make_headers() {
+  struct kind {
+    std::string_view signature;
+    bool binary;
+  };
+  const kind kinds[] = {
+      {"<!DOCTYPE html>\n<html lang=\"en\">"sv, false},
+      {"\n  <html>\n<head><title>x</title>"sv, false},
+      {"<?xml version=\"1.0\" encoding=\"UTF-8\"?>"sv, false},
+      {"%PDF-1.7\n%\xE2\xE3\xCF\xD3"sv, true},
+      {"\x89PNG\r\n\x1A\n\0\0\0\rIHDR"sv, true},
+      {"\xFF\xD8\xFF\xE0\0\x10JFIF\0"sv, true},
+      {"GIF89a\x01\0\x01\0"sv, true},
+      {"RIFF\x24\x08\0\0WEBPVP8 "sv, true},
+      {"RIFF\x24\x08\0\0WAVEfmt "sv, true},
+      {"ID3\x04\0\0\0\0\x0F"sv, true},
+      {"OggS\0\x02\0\0"sv, true},
+      {"PK\x03\x04\x14\0\x08\0"sv, true},
+      {"\x1F\x8B\x08\0\0\0\0\0"sv, true},
+      {"{\"key\": \"value\", \"list\": [1, 2, 3]}"sv, false},
+      {"Lorem ipsum dolor sit amet, consectetur"sv, false},
+      {"\x7F" "ELF\x02\x01\x01\0"sv, true},
+  };
+  std::vector<std::string> headers;
+  uint32_t seed = 1234;
+  for (size_t copy = 0; copy < 64; copy++) {
+    for (const kind &k : kinds) {
+      std::string header(k.signature);
+      while (header.size() < 512) {
+        seed = seed * 1103515245 + 12345;
+        uint8_t byte = uint8_t(seed >> 16);
+        header += k.binary ? char(byte) : char('a' + byte % 26);
+      }
+      headers.push_back(std::move(header));
+    }
+  }
+  return headers;
+}
+
+static const std::vector<std::string> headers = make_headers();
+
+// The rules for identifying an unknown MIME type as the standard writes
+// them: every row of every table is tried in turn, byte by byte.
+struct reference_row {
+  std::string_view pattern;
+  std::string_view mask;
+  bool skips_whitespace;
+  bool tag_terminated;
+  essence_id essence;
+};
+
+static bool is_whitespace(uint8_t c) {
+  return c == 0x09 || c == 0x0A || c == 0x0C || c == 0x0D || c == 0x20;
+}
+
+static bool reference_matches(std::string_view input, const reference_row &r) {
+  size_t s = 0;
+  if (r.skips_whitespace) {
+    while (s < input.size() && is_whitespace(uint8_t(input[s]))) {
+      s++;
+    }
+  }
+  size_t end = s + r.pattern.size() + r.tag_terminated;
+  if (end > input.size()) {
+    return false;
+  }
+  for (size_t p = 0; p < r.pattern.size(); p++, s++) {
+    if ((uint8_t(input[s]) & uint8_t(r.mask[p])) != uint8_t(r.pattern[p])) {
+      return false;
+    }
+  }
+  return !r.tag_terminated || input[s] == ' ' || input[s] == '>';
+}
+
+static std::vector<reference_row> make_reference_rows() {
+  std::vector<reference_row> rows;
+  const std::string_view tags[] = {
+      "<!DOCTYPE HTML", "<HTML", "<HEAD", "<SCRIPT", "<IFRAME", "<H1",
+      "<DIV",           "<FONT", "<TABLE", "<A",    "<STYLE",  "<TITLE",
+      "<B",             "<BODY", "<BR",    "<P",    "<!--"};
+  static std::string masks[std::size(tags)];
+  for (size_t i = 0; i < std::size(tags); i++) {
+    for (char c : tags[i]) {
+      masks[i] += (c >= 'A' && c <= 'Z') ? '\xDF' : '\xFF';
+    }
+    rows.push_back({tags[i], masks[i], true, true, essence_id::text_html});
+  }
+  const std::string_view ff = "\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF";
+  const std::string_view riff =
+      "\xFF\xFF\xFF\xFF\0\0\0\0\xFF\xFF\xFF\xFF\xFF\xFF"sv;
+  const reference_row others[] = {
+      {"<?xml", ff.substr(0, 5), true, false, essence_id::text_xml},
+      {"%PDF-", ff.substr(0, 5), false, false, essence_id::application_pdf},
+      {"%!PS-Adobe-", ff, false, false, essence_id::application_postscript},
+      {"\xFE\xFF\0\0"sv, "\xFF\xFF\0\0"sv, false, false,
+       essence_id::text_plain},
+      {"\xFF\xFE\0\0"sv, "\xFF\xFF\0\0"sv, false, false,
+       essence_id::text_plain},
+      {"\xEF\xBB\xBF\0"sv, "\xFF\xFF\xFF\0"sv, false, false,
+       essence_id::text_plain},
+      {"\0\0\x01\0"sv, ff.substr(0, 4), false, false, essence_id::image_x_icon},
+      {"\0\0\x02\0"sv, ff.substr(0, 4), false, false, essence_id::image_x_icon},
+      {"BM", ff.substr(0, 2), false, false, essence_id::image_bmp},
+      {"GIF87a", ff.substr(0, 6), false, false, essence_id::image_gif},
+      {"GIF89a", ff.substr(0, 6), false, false, essence_id::image_gif},
+      {"RIFF\0\0\0\0WEBPVP"sv, riff, false, false, essence_id::image_webp},
+      {"\x89PNG\r\n\x1A\n", ff.substr(0, 8), false, false,
+       essence_id::image_png},
+      {"\xFF\xD8\xFF", ff.substr(0, 3), false, false, essence_id::image_jpeg},
+      {"FORM\0\0\0\0AIFF"sv, riff.substr(0, 12), false, false,
+       essence_id::audio_aiff},
+      {"ID3", ff.substr(0, 3), false, false, essence_id::audio_mpeg},
+      {"OggS\0"sv, ff.substr(0, 5), false, false, essence_id::application_ogg},
+      {"MThd\0\0\0\x06"sv, ff.substr(0, 8), false, false,
+       essence_id::audio_midi},
+      {"RIFF\0\0\0\0AVI "sv, riff.substr(0, 12), false, false,
+       essence_id::video_avi},
+      {"RIFF\0\0\0\0WAVE"sv, riff.substr(0, 12), false, false,
+       essence_id::audio_wave},
+      {"\x1F\x8B\x08", ff.substr(0, 3), false, false,
+       essence_id::application_x_gzip},
+      {"PK\x03\x04", ff.substr(0, 4), false, false,
+       essence_id::application_zip},
+      {"Rar!\x1A\x07\0"sv, ff.substr(0, 7), false, false,
+       essence_id::application_x_rar_compressed},
+      {"Rar!\x1A\x07\x01\0"sv, ff.substr(0, 8), false, false,
+       essence_id::application_x_rar_compressed},
+  };
+  rows.insert(rows.end(), std::begin(others), std::end(others));
+  return rows;
+}
+
+static essence_id reference_identify(std::string_view header) {
+  static const std::vector<reference_row> rows = make_reference_rows();
+  for (const reference_row &r : rows) {
+    if (reference_matches(header, r)) {
+      return r.essence;
+    }
+  }
+  return ada::mimesniff::contains_binary_data_bytes(header)
+             ? essence_id::application_octet_stream
+             : essence_id::text_plain;
+}
+
+// The image rows only, in table order.
+static essence_id reference_match_image(std::string_view header) {
+  static const std::vector<reference_row> rows = [] {
+    std::vector<reference_row> image_rows;
+    for (const reference_row &r : make_reference_rows()) {
+      if (ada::mimesniff::to_string(r.essence).substr(0, 6) == "image/") {
+        image_rows.push_back(r);
+      }
+    }
+    return image_rows;
+  }();
+  for (const reference_row &r : rows) {
+    if (reference_matches(header, r)) {
+      return r.essence;
+    }
+  }
+  return essence_id::unknown;
+}
+
+static void ReferenceBench(benchmark::State &state) {
+  volatile size_t sum = 0;
+  for (auto _ : state) {
+    for (const std::string &header : headers) {
+      sum += size_t(reference_identify(header));
+    }
+  }
+  state.counters["headers/s"] = benchmark::Counter(
+      double(state.iterations() * headers.size()), benchmark::Counter::kIsRate);
+}
+BENCHMARK(ReferenceBench);
+
+static void IdentifyUnknownBench(benchmark::State &state) {
+  for (const std::string &header : headers) {
+    if (ada::mimesniff::identify_unknown_mime_type(header, true) !=
+        reference_identify(header)) {
+      state.SkipWithError("the sniffer disagrees with the reference");
+      return;
+    }
+  }
+  volatile size_t sum = 0;
+  for (auto _ : state) {
+    for (const std::string &header : headers) {
+      sum += size_t(ada::mimesniff::identify_unknown_mime_type(header, true));
+    }
+  }
+  state.counters["headers/s"] = benchmark::Counter(
+      double(state.iterations() * headers.size()), benchmark::Counter::kIsRate);
+}
+BENCHMARK(IdentifyUnknownBench);
+
+// The headers arrive in chunks of state.range(0) bytes, and sniffing stops
+// at the first decision. The bytes read count those fed to the sniffer.
+static void StreamingBench(benchmark::State &state) {
+  size_t chunk_size = size_t(state.range(0));
+  for (const std::string &header : headers) {
+    ada::mimesniff::streaming_sniffer sniffer(true);
+    for (size_t i = 0; i < header.size(); i += chunk_size) {
+      sniffer.feed(std::string_view(header).substr(i, chunk_size));
+    }
+    if (sniffer.finish() !=
+        ada::mimesniff::identify_unknown_mime_type(header, true)) {
+      state.SkipWithError("the streaming sniffer disagrees");
+      return;
+    }
+  }
+  volatile size_t sum = 0;
+  size_t bytes = 0;
+  for (auto _ : state) {
+    for (const std::string &header : headers) {
+      ada::mimesniff::streaming_sniffer sniffer(true);
+      for (size_t i = 0; i < header.size(); i += chunk_size) {
+        if (sniffer.feed(std::string_view(header).substr(i, chunk_size)) ==
+            ada::mimesniff::sniff_status::decided) {
+          break;
+        }
+      }
+      bytes += sniffer.bytes_seen();
+      sum += size_t(sniffer.finish());
+    }
+  }
+  state.SetBytesProcessed(int64_t(bytes));
+  state.counters["headers/s"] = benchmark::Counter(
+      double(state.iterations() * headers.size()), benchmark::Counter::kIsRate);
+}
+BENCHMARK(StreamingBench)->Arg(16)->Arg(64)->Arg(512);
+
+// The bytes processed count the whole header, as if each request had to be
+// read in full, which makes the rate comparable with the GB/s of a scan.
+template <essence_id (*match)(std::string_view)>
+static void ImageBench(benchmark::State &state) {
+  for (const std::string &header : headers) {
+    if (match(header) != reference_match_image(header)) {
+      state.SkipWithError("the matcher disagrees with the reference");
+      return;
+    }
+  }
+  size_t bytes = 0;
+  for (const std::string &header : headers) {
+    bytes += header.size();
+  }
+  volatile size_t sum = 0;
+  for (auto _ : state) {
+    for (const std::string &header : headers) {
+      sum += size_t(match(header));
+    }
+  }
+  state.SetBytesProcessed(int64_t(state.iterations() * bytes));
+  state.counters["headers/s"] = benchmark::Counter(
+      double(state.iterations() * headers.size()), benchmark::Counter::kIsRate);
+}
+BENCHMARK_TEMPLATE(ImageBench, reference_match_image)
+    ->Name("ImageBench/reference");
+BENCHMARK_TEMPLATE(ImageBench, ada::mimesniff::match_image_type_pattern)
+    ->Name("ImageBench/match_image_type_pattern");
+
+// Markup in any ASCII case, after some whitespace, and near misses that
+// share a prefix with a signature, as a response filter sees them.
+static std::vector<std::string> make_markup_headers() {
+  const std::string_view starts[] = {
+      "<!DOCTYPE html>", "<!doctype HTML ", "<html lang=\"en\">", "<HEAD>",
+      "<script src=",    "<iframe ",        "<h1>",               "<div>",
+      "<Font size=",     "<table>",         "<a href=",           "<style>",
+      "<title>",         "<b>",             "<Body>",             "<br>",
+      "<p>",             "<!-- x -->",      "<!DOCTYPE svg>",     "<svg ",
+      "<tablet>",        "<h2>",            "<?xml ",             "<!--x",
+      "<bold>",          "<a",              "{\"a\": 1}",         "hello",
+  };
+  std::vector<std::string> markup;
+  uint32_t seed = 4321;
+  for (size_t copy = 0; copy < 32; copy++) {
+    for (std::string_view start : starts) {
+      seed = seed * 1103515245 + 12345;
+      std::string header((seed >> 16) % 4, ' ');
+      for (char c : start) {
+        seed = seed * 1103515245 + 12345;
+        bool letter = (c | 0x20) >= 'a' && (c | 0x20) <= 'z';
+        header += letter && (seed >> 16) % 2 ? char(c ^ 0x20) : c;
+      }
+      while (header.size() < 512) {
+        seed = seed * 1103515245 + 12345;
+        header += char('a' + (seed >> 16) % 26);
+      }
+      markup.push_back(std::move(header));
+    }
+  }
+  return markup;
+}
+
+static const std::vector<std::string> markup_headers = make_markup_headers();
+
+// The HTML rows only, one after the other.
+static bool reference_matches_html(std::string_view header) {
+  static const std::vector<reference_row> rows = [] {
+    std::vector<reference_row> html_rows;
+    for (const reference_row &r : make_reference_rows()) {
+      if (r.essence == essence_id::text_html) {
+        html_rows.push_back(r);
+      }
+    }
+    return html_rows;
+  }();
+  for (const reference_row &r : rows) {
+    if (reference_matches(header, r)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+template <bool (*match)(std::string_view)>
+static void HtmlBench(benchmark::State &state) {
+  for (const std::string &header : markup_headers) {
+    if (match(header) != reference_matches_html(header)) {
+      state.SkipWithError("the matcher disagrees with the reference");
+      return;
+    }
+  }
+  volatile size_t sum = 0;
+  for (auto _ : state) {
+    for (const std::string &header : markup_headers) {
+      sum += size_t(match(header));
+    }
+  }
+  state.counters["headers/s"] =
+      benchmark::Counter(double(state.iterations() * markup_headers.size()),
+                         benchmark::Counter::kIsRate);
+}
+BENCHMARK_TEMPLATE(HtmlBench, reference_matches_html)
+    ->Name("HtmlBench/reference");
+BENCHMARK_TEMPLATE(HtmlBench, ada::mimesniff::matches_html_signature)
+    ->Name("HtmlBench/matches_html_signature");
+
+BENCHMARK_MAIN();
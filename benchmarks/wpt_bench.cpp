@@ -1,4 +1,5 @@
 #include <cstdlib>
+#include <cstring>
 #include <sstream>
 #include <fstream>
 #include <iostream>
@@ -115,6 +116,388 @@ static void BasicBench(benchmark::State &state) {
 }
 BENCHMARK(BasicBench);
 
+// Same corpus and work as BasicBench, through the batch entry point with
+// records and a bitmap that are reused across iterations.
+static void BatchBench(benchmark::State &state) {
+  std::vector<std::string_view> inputs;
+  for (const std::pair<std::string, std::string> &mime_strings :
+       mime_examples) {
+    inputs.push_back(mime_strings.first);
+  }
+  std::vector<ada::mimesniff::mimetype> results(inputs.size());
+  std::vector<uint64_t> valid((inputs.size() + 63) / 64);
+  volatile size_t mime_size = 0;
+  for (auto _ : state) {
+    ada::mimesniff::parse_mime_types(inputs.data(), inputs.size(),
+                                     results.data(), valid.data());
+    for (size_t i = 0; i < inputs.size(); i++) {
+      if (valid[i / 64] >> (i % 64) & 1) {
+        mime_size += results[i].serialized().size();
+      }
+    }
+  }
+  state.counters["time/byte"] = benchmark::Counter(
+      mime_examples_bytes, benchmark::Counter::kIsIterationInvariantRate |
+                               benchmark::Counter::kInvert);
+  state.counters["time/mime"] =
+      benchmark::Counter(double(std::size(mime_examples)),
+                         benchmark::Counter::kIsIterationInvariantRate |
+                             benchmark::Counter::kInvert);
+  state.counters["speed"] = benchmark::Counter(
+      mime_examples_bytes, benchmark::Counter::kIsIterationInvariantRate);
+  state.counters["mime/s"] =
+      benchmark::Counter(double(std::size(mime_examples)),
+                         benchmark::Counter::kIsIterationInvariantRate);
+}
+BENCHMARK(BatchBench);
+
+// Same corpus and work as BasicBench, through a cache large enough to hold
+// every distinct input, as a server seeing the same values over and over.
+static void CachedBench(benchmark::State &state) {
+  ada::mimesniff::mime_type_cache cache(2 * mime_examples.size());
+  volatile size_t mime_size = 0;
+  {
+    ada::mimesniff::mime_type_cache::session session(cache);
+    for (auto _ : state) {
+      for (const std::pair<std::string, std::string> &mime_strings :
+           mime_examples) {
+        auto mime = session.parse(mime_strings.first);
+        if (mime) {
+          mime_size += mime->serialized().size();
+        }
+      }
+    }
+  }
+  auto stats = cache.stats();
+  state.counters["hit rate"] =
+      double(stats.hits) / double(stats.hits + stats.misses);
+  state.counters["mime/s"] =
+      benchmark::Counter(double(std::size(mime_examples)),
+                         benchmark::Counter::kIsIterationInvariantRate);
+}
+BENCHMARK(CachedBench);
+
+// Answers "is it valid and already canonical?" for every input of the corpus,
+// which BasicBench answers by parsing and serializing.
+static void ValidateBench(benchmark::State &state) {
+  volatile size_t canonical = 0;
+  for (auto _ : state) {
+    for (const std::pair<std::string, std::string> &mime_strings :
+         mime_examples) {
+      canonical +=
+          ada::mimesniff::validate_mime_type(mime_strings.first).canonical;
+    }
+  }
+  state.counters["mime/s"] =
+      benchmark::Counter(double(std::size(mime_examples)),
+                         benchmark::Counter::kIsIterationInvariantRate);
+}
+BENCHMARK(ValidateBench);
+
+// Serializes the parsed records of the corpus, without parsing them again:
+// into a new string each time, into a reused header buffer, and appended to a
+// reused string.
+enum class serialize_target { string, buffer, append };
+
+template <serialize_target target>
+static void SerializeBench(benchmark::State &state) {
+  std::vector<ada::mimesniff::mimetype> records;
+  double bytes = 0;
+  for (const std::pair<std::string, std::string> &mime_strings :
+       mime_examples) {
+    auto mime = ada::mimesniff::parse_mime_type(mime_strings.first);
+    if (mime) {
+      bytes += double(mime->serialized_size());
+      records.push_back(std::move(*mime));
+    }
+  }
+  std::vector<char> buffer(4096);
+  std::string header;
+  volatile size_t written = 0;
+  for (auto _ : state) {
+    for (const ada::mimesniff::mimetype &mime : records) {
+      if constexpr (target == serialize_target::string) {
+        written += mime.serialized().size();
+      } else if constexpr (target == serialize_target::buffer) {
+        written += mime.serialize_to(buffer.data(), buffer.size());
+      } else {
+        header.clear();
+        mime.serialize_to(header);
+        written += header.size();
+      }
+    }
+  }
+  state.counters["speed"] =
+      benchmark::Counter(bytes, benchmark::Counter::kIsIterationInvariantRate);
+  state.counters["mime/s"] =
+      benchmark::Counter(double(records.size()),
+                         benchmark::Counter::kIsIterationInvariantRate);
+}
+BENCHMARK_TEMPLATE(SerializeBench, serialize_target::string)
+    ->Name("SerializeBench/string");
+BENCHMARK_TEMPLATE(SerializeBench, serialize_target::buffer)
+    ->Name("SerializeBench/buffer");
+BENCHMARK_TEMPLATE(SerializeBench, serialize_target::append)
+    ->Name("SerializeBench/append");
+
+// Rewrites each header value of the corpus to its canonical form, by parsing
+// and serializing it, and in place.
+template <bool in_place>
+static void CanonicalizeBench(benchmark::State &state) {
+  double bytes = 0;
+  for (const std::pair<std::string, std::string> &mime_strings :
+       mime_examples) {
+    bytes += double(mime_strings.first.size());
+  }
+  std::vector<char> buffer(4096);
+  volatile size_t written = 0;
+  for (auto _ : state) {
+    for (const std::pair<std::string, std::string> &mime_strings :
+         mime_examples) {
+      const std::string &input = mime_strings.first;
+      if constexpr (in_place) {
+        std::memcpy(buffer.data(), input.data(), input.size());
+        auto length = ada::mimesniff::canonicalize_in_place(
+            buffer.data(), input.size(), buffer.size());
+        written += length.value_or(0);
+      } else {
+        auto mime = ada::mimesniff::parse_mime_type(input);
+        written += mime ? mime->serialized().size() : 0;
+      }
+    }
+  }
+  state.counters["speed"] =
+      benchmark::Counter(bytes, benchmark::Counter::kIsIterationInvariantRate);
+  state.counters["mime/s"] =
+      benchmark::Counter(double(mime_examples.size()),
+                         benchmark::Counter::kIsIterationInvariantRate);
+}
+BENCHMARK_TEMPLATE(CanonicalizeBench, false)
+    ->Name("CanonicalizeBench/parse_serialize");
+BENCHMARK_TEMPLATE(CanonicalizeBench, true)
+    ->Name("CanonicalizeBench/in_place");
+
+// Looks up the charset of each value of the corpus, after parsing everything
+// and after parsing only the essence.
+template <bool lazy>
+static void CharsetBench(benchmark::State &state) {
+  double bytes = 0;
+  for (const std::pair<std::string, std::string> &mime_strings :
+       mime_examples) {
+    bytes += double(mime_strings.first.size());
+  }
+  volatile size_t found = 0;
+  for (auto _ : state) {
+    for (const std::pair<std::string, std::string> &mime_strings :
+         mime_examples) {
+      if constexpr (lazy) {
+        auto mime = ada::mimesniff::parse_mime_type_lazy(mime_strings.first);
+        if (mime) {
+          auto charset = mime->get_parameter("charset");
+          found += charset ? charset->raw_value().size() : 0;
+        }
+      } else {
+        auto mime = ada::mimesniff::parse_mime_type(mime_strings.first);
+        if (mime) {
+          auto charset = mime->get_parameter("charset");
+          found += charset ? charset->size() : 0;
+        }
+      }
+    }
+  }
+  state.counters["speed"] =
+      benchmark::Counter(bytes, benchmark::Counter::kIsIterationInvariantRate);
+  state.counters["mime/s"] =
+      benchmark::Counter(double(mime_examples.size()),
+                         benchmark::Counter::kIsIterationInvariantRate);
+}
+BENCHMARK_TEMPLATE(CharsetBench, false)->Name("CharsetBench/eager");
+BENCHMARK_TEMPLATE(CharsetBench, true)->Name("CharsetBench/lazy");
+
+// Collects the quoted boundary of multipart uploads, into a new string and
+// as a view into the header.
+template <bool view>
+static void QuotedStringBench(benchmark::State &state) {
+  std::vector<std::string> values;
+  for (size_t i = 0; i < 64; i++) {
+    values.push_back("\"----WebKitFormBoundary" + std::to_string(i * 7919) +
+                     "x7MA4YWxkTrZu0gW\"");
+  }
+  double bytes = 0;
+  for (const std::string &value : values) {
+    bytes += double(value.size());
+  }
+  std::string storage;
+  volatile size_t collected = 0;
+  for (auto _ : state) {
+    for (const std::string &value : values) {
+      std::string_view input = value;
+      if constexpr (view) {
+        collected +=
+            ada::mimesniff::collect_http_quoted_string_view(input, storage)
+                .size();
+      } else {
+        collected += ada::mimesniff::collect_http_quoted_string(input).size();
+      }
+    }
+  }
+  state.counters["speed"] =
+      benchmark::Counter(bytes, benchmark::Counter::kIsIterationInvariantRate);
+}
+BENCHMARK_TEMPLATE(QuotedStringBench, false)->Name("QuotedStringBench/string");
+BENCHMARK_TEMPLATE(QuotedStringBench, true)->Name("QuotedStringBench/view");
+
+// Classifies the parsed records of the corpus the way callers dispatch on the
+// essence: by comparing strings, and by switching on the interned id.
+static size_t classify_by_string(const ada::mimesniff::mimetype &mime) {
+  std::string_view essence = mime.essence();
+  if (essence == "text/html") return 1;
+  if (essence == "text/plain") return 2;
+  if (essence == "application/json" || essence == "text/json") return 3;
+  if (essence == "application/xml" || essence == "text/xml") return 4;
+  if (essence == "text/javascript" || essence == "application/javascript")
+    return 5;
+  if (essence == "image/png" || essence == "image/svg+xml") return 6;
+  return 0;
+}
+
+static size_t classify_by_id(const ada::mimesniff::mimetype &mime) {
+  using ada::mimesniff::essence_id;
+  switch (mime.id()) {
+    case essence_id::text_html:
+      return 1;
+    case essence_id::text_plain:
+      return 2;
+    case essence_id::application_json:
+    case essence_id::text_json:
+      return 3;
+    case essence_id::application_xml:
+    case essence_id::text_xml:
+      return 4;
+    case essence_id::text_javascript:
+    case essence_id::application_javascript:
+      return 5;
+    case essence_id::image_png:
+    case essence_id::image_svg_xml:
+      return 6;
+    default:
+      return 0;
+  }
+}
+
+template <size_t (*classify)(const ada::mimesniff::mimetype &)>
+static void EssenceDispatchBench(benchmark::State &state) {
+  std::vector<ada::mimesniff::mimetype> records;
+  for (const std::pair<std::string, std::string> &mime_strings :
+       mime_examples) {
+    auto mime = ada::mimesniff::parse_mime_type(mime_strings.first);
+    if (mime) {
+      records.push_back(std::move(*mime));
+    }
+  }
+  volatile size_t classes = 0;
+  for (auto _ : state) {
+    for (const ada::mimesniff::mimetype &mime : records) {
+      classes += classify(mime);
+    }
+  }
+  state.counters["mime/s"] =
+      benchmark::Counter(double(records.size()),
+                         benchmark::Counter::kIsIterationInvariantRate);
+}
+BENCHMARK_TEMPLATE(EssenceDispatchBench, classify_by_string)
+    ->Name("EssenceDispatchBench/string");
+BENCHMARK_TEMPLATE(EssenceDispatchBench, classify_by_id)
+    ->Name("EssenceDispatchBench/id");
+
+// Asks of every input of the corpus whether its essence is text/html, by
+// parsing it and with a precomputed matcher.
+static void EssenceParseBench(benchmark::State &state) {
+  volatile size_t matches = 0;
+  for (auto _ : state) {
+    for (const std::pair<std::string, std::string> &mime_strings :
+         mime_examples) {
+      auto mime = ada::mimesniff::parse_mime_type(mime_strings.first);
+      matches += mime && mime->essence() == "text/html";
+    }
+  }
+  state.counters["mime/s"] =
+      benchmark::Counter(double(std::size(mime_examples)),
+                         benchmark::Counter::kIsIterationInvariantRate);
+}
+BENCHMARK(EssenceParseBench);
+
+static void EssenceMatcherBench(benchmark::State &state) {
+  constexpr ada::mimesniff::essence_matcher html("text/html");
+  volatile size_t matches = 0;
+  for (auto _ : state) {
+    for (const std::pair<std::string, std::string> &mime_strings :
+         mime_examples) {
+      matches += html.matches(mime_strings.first);
+    }
+  }
+  state.counters["mime/s"] =
+      benchmark::Counter(double(std::size(mime_examples)),
+                         benchmark::Counter::kIsIterationInvariantRate);
+}
+BENCHMARK(EssenceMatcherBench);
+
+// Long headers with many parameters, as seen with multipart bodies and media
+// codecs, where the parser spends its time looking for structural bytes.
+std::vector<std::string> long_examples = {
+    "multipart/form-data; "
+    "boundary=\"----WebKitFormBoundary7MA4YWxkTrZu0gW----WebKitFormBoundary\"; "
+    "charset=utf-8",
+    "video/mp4; codecs=\"avc1.640028, mp4a.40.2, hev1.1.6.L93.B0, "
+    "vp09.00.10.08, av01.0.04M.08\"; profiles=\"isom,iso2,avc1,mp41\"",
+    "application/vnd.example.resource+json; version=2; profile=\"https://"
+    "example.com/profiles/resource\"; charset=utf-8; q=0.9; format=compact; "
+    "ext=\"a;b;c\"; level=3",
+    "text/plain;  a=1;  b=2;  c=3;  d=4;  e=5;  f=6;  g=7;  h=8;  i=9;  "
+    "j=10;  k=11;  l=12;  m=13;  n=14;  o=15;  p=16",
+};
+
+static void LongHeaderBench(benchmark::State &state) {
+  double bytes = 0;
+  for (const std::string &input : long_examples) {
+    bytes += double(input.size());
+  }
+  volatile size_t mime_size = 0;
+  for (auto _ : state) {
+    for (const std::string &input : long_examples) {
+      auto mime = ada::mimesniff::parse_mime_type(input);
+      if (mime) {
+        mime_size += mime->parameters().size();
+      }
+    }
+  }
+  state.counters["speed"] =
+      benchmark::Counter(bytes, benchmark::Counter::kIsIterationInvariantRate);
+  state.counters["mime/s"] =
+      benchmark::Counter(double(std::size(long_examples)),
+                         benchmark::Counter::kIsIterationInvariantRate);
+}
+BENCHMARK(LongHeaderBench);
+
+// Registers a copy of the benchmark for each implementation supported by the
+// processor, e.g., BasicBench/sse42, so they can be compared on one machine.
+void register_per_implementation(const char *name,
+                                 void (*bench)(benchmark::State &)) {
+  for (auto impl : ada::mimesniff::get_available_implementations()) {
+    if (!impl->supported_by_runtime_system()) {
+      continue;
+    }
+    std::string full_name = std::string(name) + "/" + std::string(impl->name());
+    benchmark::RegisterBenchmark(
+        full_name.c_str(), [impl, bench](benchmark::State &state) {
+          auto active = ada::mimesniff::get_active_implementation();
+          ada::mimesniff::set_active_implementation(impl);
+          bench(state);
+          ada::mimesniff::set_active_implementation(active);
+        });
+  }
+}
+
 int main(int argc, char **argv) {
   if (argc == 1 || !init_data(argv[1])) {
     std::cout << "pass the path to the file wpt/generated-mime-types.json as a "
@@ -139,6 +522,8 @@ int main(int argc, char **argv) {
   if (collector.has_events()) {
     benchmark::AddCustomContext("performance counters", "Enabled");
   }
+  register_per_implementation("BasicBench", BasicBench);
+  register_per_implementation("LongHeaderBench", LongHeaderBench);
   benchmark::Initialize(&argc, argv);
   benchmark::RunSpecifiedBenchmarks();
   benchmark::Shutdown();
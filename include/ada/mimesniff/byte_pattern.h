@@ -0,0 +1,319 @@
+#ifndef ADA_MIMESNIFF_BYTE_PATTERN_H
+#define ADA_MIMESNIFF_BYTE_PATTERN_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string_view>
+
+#include "ada/mimesniff/essence.h"
+#include "ada/mimesniff/portability.h"
+#include "ada/mimesniff/scanner.h"
+
+// SSE2 and NEON are part of the base instruction sets of x64 and ARM64, so
+// the compares below need no runtime dispatch.
+#if ADA_MIMESNIFF_IS_X86_64
+#include <emmintrin.h>
+#elif ADA_MIMESNIFF_IS_ARM64
+#include <arm_neon.h>
+#endif
+
+namespace ada::mimesniff {
+
+// Not constexpr on purpose: a pattern that does not fit fails the build.
+inline void invalid_byte_pattern() noexcept { std::abort(); }
+
+/**
+ * A row of the pattern tables of the MIME Sniffing standard: the resource
+ * header matches if, after skipping the leading bytes to ignore, its next
+ * bytes ANDed with the mask equal the pattern.
+ * https://mimesniff.spec.whatwg.org/#pattern-matching-algorithm
+ *
+ * The pattern and the mask are padded with zeroes to 16 bytes, so that
+ * matching is a single masked compare of 16 bytes whatever the length.
+ */
+struct byte_pattern {
+  static constexpr size_t max_size = 16;
+
+  uint8_t bytes[max_size]{};
+  uint8_t mask[max_size]{};
+  uint8_t size{0};
+  // Whether the leading whitespace bytes (0x09, 0x0A, 0x0C, 0x0D and 0x20)
+  // are ignored. It is the only set of ignored bytes the tables use.
+  bool skips_whitespace{false};
+  // Whether the pattern must be followed by a tag-terminating byte, 0x20 or
+  // 0x3E (>).
+  bool tag_terminated{false};
+  essence_id essence{essence_id::unknown};
+
+  constexpr byte_pattern() noexcept = default;
+
+  // The mask must be as long as the pattern, which is at most max_size bytes
+  // with its tag-terminating byte.
+  constexpr byte_pattern(std::string_view pattern, std::string_view masks,
+                         essence_id result, bool skip_whitespace = false,
+                         bool terminated = false) noexcept
+      : size(uint8_t(pattern.size())),
+        skips_whitespace(skip_whitespace),
+        tag_terminated(terminated),
+        essence(result) {
+    if (pattern.empty() || pattern.size() != masks.size() ||
+        pattern.size() + terminated > max_size) {
+      invalid_byte_pattern();
+      return;
+    }
+    for (size_t i = 0; i < pattern.size(); i++) {
+      mask[i] = uint8_t(masks[i]);
+      bytes[i] = uint8_t(pattern[i]) & mask[i];
+    }
+  }
+
+  // The byte the patterns are dispatched on. It is never masked.
+  constexpr uint8_t first_byte() const noexcept { return bytes[0]; }
+};
+
+constexpr inline bool is_sniffing_whitespace(uint8_t c) noexcept {
+  return c == 0x09 || c == 0x0A || c == 0x0C || c == 0x0D || c == 0x20;
+}
+
+constexpr inline bool is_tag_terminating_byte(uint8_t c) noexcept {
+  return c == 0x20 || c == 0x3E;
+}
+
+/**
+ * Returns true if the 16 bytes at `window` ANDed with the mask of the pattern
+ * equal its bytes. Past the size of the pattern, both are zero, so whatever
+ * the window holds there matches.
+ */
+inline bool masked_equal(const uint8_t* window,
+                         const byte_pattern& pattern) noexcept {
+#if ADA_MIMESNIFF_IS_X86_64
+  __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(window));
+  __m128i m = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pattern.mask));
+  __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pattern.bytes));
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(v, m), b)) == 0xFFFF;
+#elif ADA_MIMESNIFF_IS_ARM64
+  uint8x16_t v = vld1q_u8(window);
+  uint8x16_t equal =
+      vceqq_u8(vandq_u8(v, vld1q_u8(pattern.mask)), vld1q_u8(pattern.bytes));
+  return vminvq_u8(equal) == 0xFF;
+#else
+  uint64_t words[2], masks[2], bytes[2];
+  std::memcpy(words, window, sizeof(words));
+  std::memcpy(masks, pattern.mask, sizeof(masks));
+  std::memcpy(bytes, pattern.bytes, sizeof(bytes));
+  return ((words[0] & masks[0]) ^ bytes[0]) == 0 &&
+         ((words[1] & masks[1]) ^ bytes[1]) == 0;
+#endif
+}
+
+/**
+ * Returns the offset of the first tag-terminating byte among the 16 bytes at
+ * `window`, or 16 if there is none.
+ */
+inline size_t find_tag_terminating_byte(const uint8_t* window) noexcept {
+#if ADA_MIMESNIFF_IS_X86_64
+  __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(window));
+  __m128i found = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(0x20)),
+                               _mm_cmpeq_epi8(v, _mm_set1_epi8(0x3E)));
+  // The bit past the window stops the count at 16.
+  return size_t(trailing_zeroes(uint64_t(_mm_movemask_epi8(found)) | 0x10000));
+#elif ADA_MIMESNIFF_IS_ARM64
+  uint8x16_t v = vld1q_u8(window);
+  uint8x16_t found =
+      vorrq_u8(vceqq_u8(v, vdupq_n_u8(0x20)), vceqq_u8(v, vdupq_n_u8(0x3E)));
+  // Narrowing leaves four bits per byte.
+  uint64_t mask = vget_lane_u64(
+      vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(found), 4)), 0);
+  return mask == 0 ? byte_pattern::max_size
+                   : size_t(trailing_zeroes(mask)) / 4;
+#else
+  size_t i = 0;
+  while (i < byte_pattern::max_size && !is_tag_terminating_byte(window[i])) {
+    i++;
+  }
+  return i;
+#endif
+}
+
+// Returns the offset of the first byte of the header that is not whitespace,
+// or its size.
+inline size_t skip_sniffing_whitespace(std::string_view header) noexcept {
+  size_t start = 0;
+  while (start < header.size() &&
+         is_sniffing_whitespace(uint8_t(header[start]))) {
+    start++;
+  }
+  return start;
+}
+
+/**
+ * Returns the 16 bytes of the header from `start`, which must be less than
+ * its size. Near the end of the header, they are copied to `padded` and
+ * padded with zeroes.
+ */
+inline const uint8_t* load_pattern_window(
+    std::string_view header, size_t start,
+    uint8_t (&padded)[byte_pattern::max_size]) noexcept {
+  const uint8_t* window =
+      reinterpret_cast<const uint8_t*>(header.data()) + start;
+  size_t available = header.size() - start;
+  if (available >= byte_pattern::max_size) {
+    return window;
+  }
+  std::memcpy(padded, window, available);
+  std::memset(padded + available, 0, byte_pattern::max_size - available);
+  return padded;
+}
+
+// The outcome of matching a header of which only a prefix is known.
+struct prefix_match {
+  // The essence of the matching pattern, or essence_id::unknown.
+  essence_id essence{essence_id::unknown};
+  // When no pattern matches yet, the number of bytes the first pattern that
+  // may still match is missing, or zero if none may.
+  size_t bytes_needed{0};
+};
+
+/**
+ * A pattern table compiled for matching: the patterns are grouped by their
+ * first byte, keeping their order within a group, so a resource header is
+ * only compared to the few patterns that start with its first byte. The
+ * whole table takes a few kilobytes and stays in the L1 cache.
+ */
+template <size_t N>
+struct compiled_pattern_table {
+  std::array<byte_pattern, N> patterns{};
+  // The patterns starting with byte b are patterns[begin[b], begin[b + 1]).
+  std::array<uint16_t, 257> begin{};
+
+  // The most patterns a header can be compared to.
+  constexpr size_t max_group_size() const noexcept {
+    size_t most = 0;
+    for (size_t b = 0; b < 256; b++) {
+      size_t group = size_t(begin[b + 1] - begin[b]);
+      most = group > most ? group : most;
+    }
+    return most;
+  }
+
+  /**
+   * Returns the essence of the first pattern, in table order, that the
+   * resource header matches, or essence_id::unknown.
+   *
+   * No pattern starts with a whitespace byte, so when the header does, only
+   * the patterns that skip whitespace can match, and they are looked up by
+   * the first byte that is not whitespace.
+   */
+  essence_id match(std::string_view header) const noexcept {
+    size_t start = skip_sniffing_whitespace(header);
+    if (start == header.size()) {
+      return essence_id::unknown;
+    }
+    size_t available = header.size() - start;
+    uint8_t padded[byte_pattern::max_size];
+    const uint8_t* window = load_pattern_window(header, start, padded);
+    uint8_t first = window[0];
+    for (size_t i = begin[first]; i < begin[size_t(first) + 1]; i++) {
+      const byte_pattern& p = patterns[i];
+      if ((start > 0 && !p.skips_whitespace) || p.size > available ||
+          !masked_equal(window, p)) {
+        continue;
+      }
+      if (p.tag_terminated &&
+          (p.size == available || !is_tag_terminating_byte(window[p.size]))) {
+        continue;
+      }
+      return p.essence;
+    }
+    return essence_id::unknown;
+  }
+
+  /**
+   * Like match, when only the first `available` bytes after the leading
+   * whitespace are known, and `skipped_whitespace` tells whether there was
+   * any. The window holds these bytes, padded with zeroes to 16 bytes. Unless
+   * `complete`, more bytes may follow, so a pattern that the known bytes
+   * match but do not cover stops the search: the patterns after it cannot
+   * win before it fails.
+   */
+  prefix_match match_prefix(const uint8_t* window, size_t available,
+                            bool skipped_whitespace,
+                            bool complete) const noexcept {
+    if (available == 0) {
+      return {essence_id::unknown, complete ? size_t(0) : size_t(1)};
+    }
+    uint8_t first = window[0];
+    for (size_t i = begin[first]; i < begin[size_t(first) + 1]; i++) {
+      const byte_pattern& p = patterns[i];
+      if (skipped_whitespace && !p.skips_whitespace) {
+        continue;
+      }
+      size_t needed = p.size + p.tag_terminated;
+      if (available >= needed) {
+        if (masked_equal(window, p) &&
+            (!p.tag_terminated || is_tag_terminating_byte(window[p.size]))) {
+          return {p.essence, 0};
+        }
+        continue;
+      }
+      if (complete) {
+        continue;
+      }
+      bool may_match = true;
+      for (size_t j = 0; j < available && j < p.size; j++) {
+        may_match = may_match && (window[j] & p.mask[j]) == p.bytes[j];
+      }
+      if (may_match) {
+        return {essence_id::unknown, needed - available};
+      }
+    }
+    return {};
+  }
+};
+
+/**
+ * Groups the patterns by first byte, at compile time. Every pattern must have
+ * its first byte unmasked and other than whitespace.
+ */
+template <size_t N>
+constexpr compiled_pattern_table<N> compile_pattern_table(
+    const std::array<byte_pattern, N>& patterns) noexcept {
+  compiled_pattern_table<N> table{};
+  std::array<uint16_t, 257> counts{};
+  for (const byte_pattern& p : patterns) {
+    if (p.mask[0] != 0xFF || is_sniffing_whitespace(p.first_byte())) {
+      invalid_byte_pattern();
+    }
+    counts[p.first_byte()]++;
+  }
+  for (size_t b = 0; b < 256; b++) {
+    table.begin[b + 1] = uint16_t(table.begin[b] + counts[b]);
+  }
+  std::array<uint16_t, 257> next = table.begin;
+  for (const byte_pattern& p : patterns) {
+    table.patterns[next[p.first_byte()]++] = p;
+  }
+  return table;
+}
+
+// Concatenates pattern tables, in order, at compile time.
+template <size_t N, size_t M>
+constexpr std::array<byte_pattern, N + M> concat_patterns(
+    const std::array<byte_pattern, N>& a,
+    const std::array<byte_pattern, M>& b) noexcept {
+  std::array<byte_pattern, N + M> out{};
+  for (size_t i = 0; i < N; i++) {
+    out[i] = a[i];
+  }
+  for (size_t i = 0; i < M; i++) {
+    out[N + i] = b[i];
+  }
+  return out;
+}
+
+}  // namespace ada::mimesniff
+
+#endif  // ADA_MIMESNIFF_BYTE_PATTERN_H
@@ -0,0 +1,175 @@
+#ifndef ADA_MIMESNIFF_CACHE_H
+#define ADA_MIMESNIFF_CACHE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "ada/mimesniff/mimetype.h"
+
+namespace ada::mimesniff {
+
+/**
+ * A fast, non-cryptographic hash of the bytes, eight at a time.
+ */
+uint64_t hash_bytes(std::string_view input) noexcept;
+
+/**
+ * A bounded cache in front of parse_mime_type, for servers that see the same
+ * few hundred header values over and over. Results are keyed by the exact
+ * input bytes and shared between callers as immutable records; invalid inputs
+ * are cached too. When a shard is full, the CLOCK algorithm evicts an entry
+ * that has not been used since the hand last passed over it.
+ *
+ * Each thread reads through its own `session`:
+ *
+ *   mime_type_cache cache;
+ *   // In every worker thread:
+ *   mime_type_cache::session session(cache);
+ *   const mimetype* type = session.parse(header);
+ *
+ * A hit writes nothing that other threads read: no lock, no reference count
+ * and no shared counter. The entries are published as immutable nodes through
+ * atomic pointers, and the counters belong to the session. A node that is
+ * evicted is freed once every session has called parse again, or has been
+ * destroyed, since it was evicted. A session that stays idle holds back the
+ * nodes evicted in the meantime, which its destruction releases.
+ *
+ * Misses and evictions take the lock of one of the shards, so threads
+ * parsing different values rarely wait for each other.
+ */
+class mime_type_cache {
+ private:
+  struct node;
+  struct reader_slot;
+
+ public:
+  struct statistics {
+    uint64_t hits{};
+    uint64_t misses{};
+    uint64_t evictions{};
+    size_t size{};  // the number of cached inputs
+  };
+
+  // Inputs longer than this are parsed but never cached, which bounds the
+  // memory used by the keys.
+  static constexpr size_t max_cached_input_size = 1024;
+
+  /**
+   * Looks up the cache for a single thread. It must be destroyed before the
+   * cache.
+   */
+  class session {
+   public:
+    explicit session(mime_type_cache& cache);
+    ~session();
+    session(const session&) = delete;
+    session& operator=(const session&) = delete;
+
+    /**
+     * Returns the parsed MIME type, or nullptr if the input is not a valid
+     * MIME type. The record stays valid until the next call to parse on this
+     * session or its destruction, even if it is evicted in the meantime.
+     */
+    const mimetype* parse(std::string_view input);
+
+   private:
+    mime_type_cache& cache_;
+    reader_slot& slot_;
+    // The record of the last input too long to be cached.
+    mimetype uncached_{};
+  };
+
+  /**
+   * Holds at most `capacity` inputs, rounded up to a multiple of the number
+   * of shards.
+   */
+  explicit mime_type_cache(size_t capacity = 1024, size_t shard_count = 16);
+  ~mime_type_cache();
+  mime_type_cache(const mime_type_cache&) = delete;
+  mime_type_cache& operator=(const mime_type_cache&) = delete;
+
+  // A snapshot of the counters, summed over the sessions and the shards.
+  statistics stats() const;
+
+  size_t capacity() const noexcept { return shard_count_ * shard_capacity_; }
+
+  // Removes every entry. The counters are kept.
+  void clear();
+
+ private:
+  // Set as the epoch of a session that holds no record.
+  static constexpr uint64_t offline = ~uint64_t(0);
+
+  // A cached input. Only `referenced` changes once it is published.
+  struct node {
+    uint64_t hash{};
+    std::string key{};
+    bool valid{false};
+    mimetype value{};
+    // Set on every hit and cleared by the CLOCK hand.
+    mutable std::atomic<bool> referenced{false};
+  };
+
+  // What a session shares with the writers, on a cache line of its own.
+  struct alignas(64) reader_slot {
+    // The epoch of the cache when the session last called parse, or offline.
+    std::atomic<uint64_t> epoch{offline};
+    // Only the session writes them, so they are stored, not incremented.
+    std::atomic<uint64_t> hits{0};
+    std::atomic<uint64_t> misses{0};
+    bool in_use{false};
+  };
+
+  struct alignas(64) shard {
+    std::mutex mutex{};
+    // Open addressing with linear probing, at most half full. Readers probe
+    // it without the lock; only the writers, under the lock, store to it.
+    std::unique_ptr<std::atomic<node*>[]> table{};
+    size_t table_mask{0};
+    // The cached nodes, in the order the CLOCK hand visits them.
+    std::vector<node*> clock{};
+    size_t hand{0};
+    uint64_t evictions{0};
+  };
+
+  // An evicted node, and the epoch every session must reach before it is
+  // freed.
+  struct retired_node {
+    node* evicted;
+    uint64_t epoch;
+  };
+
+  shard& shard_of(uint64_t hash) const noexcept;
+  static const node* find(const shard& s, uint64_t hash,
+                          std::string_view input) noexcept;
+  static void erase(shard& s, const node* victim) noexcept;
+  const node* insert(uint64_t hash, std::string_view input);
+  // Frees the nodes once no session can hold them.
+  void retire(const std::vector<node*>& evicted);
+  // Frees the retired nodes that no session can hold, readers_mutex_ held.
+  void reclaim();
+
+  size_t shard_count_;
+  size_t shard_capacity_;
+  std::unique_ptr<shard[]> shards_;
+  // Bumped after nodes are unlinked.
+  std::atomic<uint64_t> epoch_{1};
+
+  mutable std::mutex readers_mutex_{};
+  std::vector<std::unique_ptr<reader_slot>> readers_{};
+  std::vector<retired_node> retired_{};
+  // The counters of the sessions that were destroyed.
+  uint64_t past_hits_{0};
+  uint64_t past_misses_{0};
+};
+
+}  // namespace ada::mimesniff
+
+#endif  // ADA_MIMESNIFF_CACHE_H
@@ -0,0 +1,43 @@
+#ifndef ADA_MIMESNIFF_CANONICALIZE_H
+#define ADA_MIMESNIFF_CANONICALIZE_H
+
+#include <cstddef>
+#include <optional>
+#include <string_view>
+
+namespace ada::mimesniff {
+
+/**
+ * A change to one parameter, applied while canonicalizing. With a value, the
+ * parameter is set to it: replaced where it appears, appended otherwise.
+ * Without a value, the parameter is removed. An empty name changes nothing.
+ */
+struct parameter_edit {
+  // In ASCII lowercase, solely HTTP token code points.
+  std::string_view name{};
+  // Solely HTTP quoted-string token code points. It must not point into the
+  // buffer being canonicalized.
+  std::optional<std::string_view> value{};
+};
+
+/**
+ * Rewrites the MIME type in buffer[0, length) to its serialization, as
+ * `parse_mime_type` followed by `serialized()` would, after applying the
+ * edit. The result may be longer than the input when quotes or escapes are
+ * added; it may use the buffer up to `capacity` bytes, which is at least
+ * `length`. Returns the length of the result.
+ *
+ * Returns std::nullopt, leaving the buffer untouched, if the input is not a
+ * valid MIME type, if the edit is invalid or if the result does not fit.
+ * The size of the result is computed first without writing anything, then
+ * the components are packed in place and serialized. Nothing is allocated
+ * unless the input has more than parameter_name_set::linear_threshold
+ * parameters.
+ */
+std::optional<size_t> canonicalize_in_place(char* buffer, size_t length,
+                                            size_t capacity,
+                                            const parameter_edit& edit = {});
+
+}  // namespace ada::mimesniff
+
+#endif  // ADA_MIMESNIFF_CANONICALIZE_H
@@ -0,0 +1,242 @@
+#ifndef ADA_MIMESNIFF_ESSENCE_H
+#define ADA_MIMESNIFF_ESSENCE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace ada::mimesniff {
+
+// The well-known essences, as (identifier, essence) pairs. To add one, append
+// it, then call make_essence_hash_seed() below, for instance from a scratch
+// program, and set essence_hash_table::default_seed to what it returns:
+// until then, the seed may make two essences collide, which fails the build.
+#define ADA_MIMESNIFF_ESSENCES(X)                                             \
+  X(text_plain, "text/plain")                                                 \
+  X(text_html, "text/html")                                                   \
+  X(text_xml, "text/xml")                                                     \
+  X(text_css, "text/css")                                                     \
+  X(text_csv, "text/csv")                                                     \
+  X(text_markdown, "text/markdown")                                           \
+  X(text_vtt, "text/vtt")                                                     \
+  X(text_event_stream, "text/event-stream")                                   \
+  X(text_calendar, "text/calendar")                                           \
+  X(text_javascript, "text/javascript")                                       \
+  X(text_ecmascript, "text/ecmascript")                                       \
+  X(text_javascript1_0, "text/javascript1.0")                                 \
+  X(text_javascript1_1, "text/javascript1.1")                                 \
+  X(text_javascript1_2, "text/javascript1.2")                                 \
+  X(text_javascript1_3, "text/javascript1.3")                                 \
+  X(text_javascript1_4, "text/javascript1.4")                                 \
+  X(text_javascript1_5, "text/javascript1.5")                                 \
+  X(text_jscript, "text/jscript")                                             \
+  X(text_livescript, "text/livescript")                                       \
+  X(text_x_ecmascript, "text/x-ecmascript")                                   \
+  X(text_x_javascript, "text/x-javascript")                                   \
+  X(text_json, "text/json")                                                   \
+  X(application_javascript, "application/javascript")                         \
+  X(application_ecmascript, "application/ecmascript")                         \
+  X(application_x_ecmascript, "application/x-ecmascript")                     \
+  X(application_x_javascript, "application/x-javascript")                     \
+  X(application_json, "application/json")                                     \
+  X(application_ld_json, "application/ld+json")                               \
+  X(application_manifest_json, "application/manifest+json")                   \
+  X(application_problem_json, "application/problem+json")                     \
+  X(application_xml, "application/xml")                                       \
+  X(application_xhtml_xml, "application/xhtml+xml")                           \
+  X(application_rss_xml, "application/rss+xml")                               \
+  X(application_atom_xml, "application/atom+xml")                             \
+  X(application_octet_stream, "application/octet-stream")                     \
+  X(application_pdf, "application/pdf")                                       \
+  X(application_postscript, "application/postscript")                         \
+  X(application_ogg, "application/ogg")                                       \
+  X(application_wasm, "application/wasm")                                     \
+  X(application_zip, "application/zip")                                       \
+  X(application_gzip, "application/gzip")                                     \
+  X(application_x_gzip, "application/x-gzip")                                 \
+  X(application_x_rar_compressed, "application/x-rar-compressed")             \
+  X(application_x_www_form_urlencoded,                                        \
+    "application/x-www-form-urlencoded")                                      \
+  X(application_font_cff, "application/font-cff")                             \
+  X(application_font_off, "application/font-off")                             \
+  X(application_font_sfnt, "application/font-sfnt")                           \
+  X(application_font_ttf, "application/font-ttf")                             \
+  X(application_font_woff, "application/font-woff")                           \
+  X(application_vnd_ms_fontobject, "application/vnd.ms-fontobject")           \
+  X(application_vnd_ms_opentype, "application/vnd.ms-opentype")               \
+  X(multipart_form_data, "multipart/form-data")                               \
+  X(multipart_byteranges, "multipart/byteranges")                             \
+  X(multipart_mixed, "multipart/mixed")                                       \
+  X(image_png, "image/png")                                                   \
+  X(image_jpeg, "image/jpeg")                                                 \
+  X(image_gif, "image/gif")                                                   \
+  X(image_webp, "image/webp")                                                 \
+  X(image_bmp, "image/bmp")                                                   \
+  X(image_x_icon, "image/x-icon")                                             \
+  X(image_vnd_microsoft_icon, "image/vnd.microsoft.icon")                     \
+  X(image_svg_xml, "image/svg+xml")                                           \
+  X(image_avif, "image/avif")                                                 \
+  X(audio_aiff, "audio/aiff")                                                 \
+  X(audio_basic, "audio/basic")                                               \
+  X(audio_midi, "audio/midi")                                                 \
+  X(audio_mpeg, "audio/mpeg")                                                 \
+  X(audio_mp4, "audio/mp4")                                                   \
+  X(audio_ogg, "audio/ogg")                                                   \
+  X(audio_wave, "audio/wave")                                                 \
+  X(audio_webm, "audio/webm")                                                 \
+  X(video_avi, "video/avi")                                                   \
+  X(video_mp4, "video/mp4")                                                   \
+  X(video_mpeg, "video/mpeg")                                                 \
+  X(video_ogg, "video/ogg")                                                   \
+  X(video_webm, "video/webm")                                                 \
+  X(font_collection, "font/collection")                                       \
+  X(font_otf, "font/otf")                                                     \
+  X(font_sfnt, "font/sfnt")                                                   \
+  X(font_ttf, "font/ttf")                                                     \
+  X(font_woff, "font/woff")                                                   \
+  X(font_woff2, "font/woff2")
+
+/**
+ * A small integer naming a well-known essence, so that code can switch on the
+ * essence of a MIME type instead of comparing strings. Every essence that is
+ * not in the list maps to `unknown`.
+ */
+enum class essence_id : uint8_t {
+  unknown = 0,
+#define ADA_MIMESNIFF_ESSENCE_ID(id, essence) id,
+  ADA_MIMESNIFF_ESSENCES(ADA_MIMESNIFF_ESSENCE_ID)
+#undef ADA_MIMESNIFF_ESSENCE_ID
+};
+
+// The essences indexed by essence_id. The entry of `unknown` is empty.
+constexpr inline std::string_view essence_names[] = {
+    "",
+#define ADA_MIMESNIFF_ESSENCE_NAME(id, essence) essence,
+    ADA_MIMESNIFF_ESSENCES(ADA_MIMESNIFF_ESSENCE_NAME)
+#undef ADA_MIMESNIFF_ESSENCE_NAME
+};
+
+constexpr inline size_t essence_id_count =
+    sizeof(essence_names) / sizeof(essence_names[0]);
+static_assert(essence_id_count <= 256, "essence_id is a single byte");
+
+// Returns the essence named by the id, e.g. "text/html".
+constexpr inline std::string_view to_string(essence_id id) noexcept {
+  return essence_names[size_t(id)];
+}
+
+/**
+ * A perfect hash of the well-known essences. The key packs the first and last
+ * four bytes of the subtype with the lengths and the first byte of the type,
+ * which tells all the listed essences apart, so a probe costs a handful of
+ * loads and two multiplications. The table is filled at compile time.
+ */
+struct essence_hash_table {
+  static constexpr int bits = 9;
+  static constexpr size_t size = size_t(1) << bits;
+
+  // The first of the candidate multipliers (see make_essence_hash_seed) for
+  // which no two essences land in the same slot. Searching for it takes
+  // seconds of constant evaluation, so it is pinned here and only checked.
+  static constexpr uint64_t default_seed = 0x5AEE7F2E7518F34Full;
+
+  uint64_t seed{};
+  // Whether every essence has a slot of its own.
+  bool perfect{};
+  // The essence_id of each slot, unknown when the slot is free.
+  uint8_t slots[size]{};
+
+  // Loads up to four bytes, the missing ones are zero.
+  static constexpr uint64_t load(std::string_view bytes) noexcept {
+    uint64_t word = 0;
+    for (size_t i = 0; i < bytes.size() && i < 4; i++) {
+      word |= uint64_t(uint8_t(bytes[i])) << (8 * i);
+    }
+    return word;
+  }
+
+  static constexpr size_t hash(std::string_view type, std::string_view subtype,
+                               uint64_t seed) noexcept {
+    size_t tail = subtype.size() < 4 ? 0 : subtype.size() - 4;
+    uint64_t key = load(subtype) | load(subtype.substr(tail)) << 32;
+    key ^= (uint64_t(type.size()) | uint64_t(subtype.size()) << 8 |
+            uint64_t(uint8_t(type[0])) << 16) *
+           seed;
+    key ^= key >> 32;
+    return size_t((key * seed) >> (64 - bits));
+  }
+};
+
+constexpr inline essence_hash_table make_essence_hash_table(uint64_t seed) {
+  essence_hash_table table{};
+  table.seed = seed;
+  table.perfect = true;
+  for (size_t id = 1; id < essence_id_count; id++) {
+    std::string_view essence = essence_names[id];
+    size_t slash = essence.find('/');
+    size_t slot = essence_hash_table::hash(essence.substr(0, slash),
+                                           essence.substr(slash + 1), seed);
+    if (table.slots[slot] != 0) {
+      table.perfect = false;
+    }
+    table.slots[slot] = uint8_t(id);
+  }
+  return table;
+}
+
+// Returns the first multiplier (i * 0x9E3779B97F4A7C15) | 1, i = 1, 2, ...,
+// that makes the hash perfect. Run it to update default_seed after changing
+// the list of essences.
+constexpr inline uint64_t make_essence_hash_seed() {
+  for (uint64_t attempt = 1;; attempt++) {
+    uint64_t seed = (attempt * 0x9E3779B97F4A7C15ull) | 1;
+    if (make_essence_hash_table(seed).perfect) {
+      return seed;
+    }
+  }
+}
+
+constexpr inline essence_hash_table essence_lookup =
+    make_essence_hash_table(essence_hash_table::default_seed);
+static_assert(essence_lookup.perfect,
+              "two essences collide: update essence_hash_table::default_seed "
+              "with make_essence_hash_seed()");
+
+/**
+ * Returns the id of the essence "type/subtype", or essence_id::unknown. The
+ * type and the subtype are expected to be non-empty and in ASCII lowercase,
+ * as they are in a parsed MIME type.
+ */
+constexpr inline essence_id lookup_essence(std::string_view type,
+                                           std::string_view subtype) noexcept {
+  if (type.empty() || subtype.empty()) {
+    return essence_id::unknown;
+  }
+  uint8_t id = essence_lookup.slots[essence_hash_table::hash(
+      type, subtype, essence_lookup.seed)];
+  // A single comparison tells whether the input is the essence of the slot.
+  std::string_view candidate = essence_names[id];
+  if (candidate.size() != type.size() + 1 + subtype.size() ||
+      candidate.substr(0, type.size()) != type ||
+      candidate.substr(type.size() + 1) != subtype) {
+    return essence_id::unknown;
+  }
+  return essence_id(id);
+}
+
+// Returns the id of an essence given as "type/subtype".
+constexpr inline essence_id lookup_essence(std::string_view essence) noexcept {
+  size_t slash = essence.find('/');
+  if (slash == std::string_view::npos) {
+    return essence_id::unknown;
+  }
+  return lookup_essence(essence.substr(0, slash), essence.substr(slash + 1));
+}
+
+static_assert(lookup_essence("application/json") ==
+                  essence_id::application_json,
+              "every listed essence maps to its own id");
+
+}  // namespace ada::mimesniff
+
+#endif  // ADA_MIMESNIFF_ESSENCE_H
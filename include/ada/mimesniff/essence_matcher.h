@@ -0,0 +1,149 @@
+#ifndef ADA_MIMESNIFF_ESSENCE_MATCHER_H
+#define ADA_MIMESNIFF_ESSENCE_MATCHER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string_view>
+
+#include "ada/mimesniff/essence.h"
+#include "ada/mimesniff/portability.h"
+#include "ada/mimesniff/util-inl.h"
+#include "ada/mimesniff/util.h"
+
+namespace ada::mimesniff {
+
+// Not constexpr on purpose: a matcher built from an invalid essence in a
+// constant expression fails the build.
+inline void invalid_essence_matcher() noexcept { std::abort(); }
+
+/**
+ * Tells whether a header value has a given essence without parsing it:
+ * `matcher.matches(input)` is true iff `parse_mime_type(input)` succeeds with
+ * that essence. The essence is turned into 64-bit words at compile time, with
+ * a mask that has U+0020 set at the positions of ASCII letters, so a match is
+ * a few word compares: (input | mask) == essence.
+ *
+ *   constexpr essence_matcher json("application/json");
+ *   if (json.matches(request.content_type)) ...
+ *
+ * C++17 does not allow string literals as template arguments, which is why
+ * the essence is given to a constexpr object rather than to a template.
+ */
+class essence_matcher {
+ public:
+  static constexpr size_t max_size = 64;
+
+  /**
+   * The essence must be of the form "type/subtype" where type and subtype are
+   * non-empty and solely contain HTTP token code points, and at most
+   * `max_size` bytes long. Case does not matter.
+   */
+  constexpr explicit essence_matcher(std::string_view essence) noexcept
+      : size_(essence.size()), id_(essence_id::unknown) {
+    size_t slash = essence.find('/');
+    if (essence.size() > max_size || slash == std::string_view::npos ||
+        slash == 0 || slash + 1 == essence.size() ||
+        (http_tokens_map(essence.substr(0, slash)) & 128) ||
+        (http_tokens_map(essence.substr(slash + 1)) & 128)) {
+      invalid_essence_matcher();
+      return;
+    }
+    for (size_t i = 0; i < essence.size(); i++) {
+      char c = essence[i];
+      bool letter = (c | 0x20) >= 'a' && (c | 0x20) <= 'z';
+      uint64_t fold = letter ? 0x20 : 0;
+      uint64_t byte = uint8_t(c) | fold;
+      words_[i / 8] |= byte << (8 * (i % 8));
+      masks_[i / 8] |= fold << (8 * (i % 8));
+      // The last eight bytes, compared by an overlapping load.
+      if (size_ >= 8 && i >= size_ - 8) {
+        tail_word_ |= byte << (8 * (i - (size_ - 8)));
+        tail_mask_ |= fold << (8 * (i - (size_ - 8)));
+      }
+    }
+    char lowered[max_size]{};
+    for (size_t i = 0; i < size_; i++) {
+      lowered[i] = char(uint8_t(words_[i / 8] >> (8 * (i % 8))));
+    }
+    id_ = lookup_essence(std::string_view(lowered, size_));
+  }
+
+  // The essence in ASCII lowercase.
+  constexpr size_t size() const noexcept { return size_; }
+
+  // The id of the essence, or essence_id::unknown.
+  constexpr essence_id id() const noexcept { return id_; }
+
+  /**
+   * Returns true iff the input is a valid MIME type with this essence. Like
+   * the parser, it skips leading HTTP whitespace and allows HTTP whitespace
+   * between the subtype and the first U+003B (;), if any. The parameters are
+   * not looked at: they cannot make a MIME type with a valid essence fail.
+   */
+  constexpr bool matches(std::string_view input) const noexcept {
+    size_t start = 0;
+    while (start < input.size() && is_http_whitespace(input[start])) {
+      start++;
+    }
+    if (input.size() - start < size_) {
+      return false;
+    }
+    const char* data = input.data() + start;
+    size_t full_words = size_ / 8;
+    for (size_t w = 0; w < full_words; w++) {
+      if ((load(data + 8 * w, 8) | masks_[w]) != words_[w]) {
+        return false;
+      }
+    }
+    if (size_ % 8 != 0) {
+      bool equal = size_ >= 8 ? (load(data + size_ - 8, 8) | tail_mask_) ==
+                                    tail_word_
+                              : (load(data, size_) | masks_[0]) == words_[0];
+      if (!equal) {
+        return false;
+      }
+    }
+    // The subtype ends at the first U+003B (;), after any trailing HTTP
+    // whitespace.
+    for (size_t i = start + size_; i < input.size(); i++) {
+      if (input[i] == ';') {
+        return true;
+      }
+      if (!is_http_whitespace(input[i])) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+ private:
+  // Loads up to eight bytes, the missing ones are zero.
+  static constexpr uint64_t load(const char* bytes, size_t length) noexcept {
+    // The words are built in little-endian order, which is what a single
+    // load gives on most processors.
+    if (!ADA_MIMESNIFF_IS_BIG_ENDIAN && !is_constant_evaluated() &&
+        length == 8) {
+      uint64_t word{};
+      std::memcpy(&word, bytes, sizeof(word));
+      return word;
+    }
+    uint64_t word = 0;
+    for (size_t i = 0; i < length; i++) {
+      word |= uint64_t(uint8_t(bytes[i])) << (8 * i);
+    }
+    return word;
+  }
+
+  uint64_t words_[max_size / 8]{};
+  uint64_t masks_[max_size / 8]{};
+  uint64_t tail_word_{};
+  uint64_t tail_mask_{};
+  size_t size_;
+  essence_id id_;
+};
+
+}  // namespace ada::mimesniff
+
+#endif  // ADA_MIMESNIFF_ESSENCE_MATCHER_H
@@ -0,0 +1,104 @@
+#ifndef ADA_MIMESNIFF_IMPLEMENTATION_H
+#define ADA_MIMESNIFF_IMPLEMENTATION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "ada/mimesniff/portability.h"
+
+namespace ada::mimesniff {
+
+struct structural_masks;
+
+// The instruction sets an implementation may require. They can be combined.
+struct instruction_set {
+  static constexpr uint32_t sse42 = 1;
+  static constexpr uint32_t avx2 = 2;
+  static constexpr uint32_t avx512 = 4;  // AVX-512 F and BW
+  static constexpr uint32_t neon = 8;
+};
+
+/**
+ * A set of kernels written for one instruction set. The library is compiled
+ * with every implementation that the target architecture may use, and picks
+ * the best one supported by the processor the first time a kernel is needed,
+ * in the manner of simdjson and simdutf.
+ */
+class implementation {
+ public:
+  virtual ~implementation() = default;
+
+  // The name of the implementation: "scalar", "sse42", "avx2", "avx512" or
+  // "neon".
+  std::string_view name() const noexcept { return name_; }
+  std::string_view description() const noexcept { return description_; }
+  uint32_t required_instruction_sets() const noexcept {
+    return required_instruction_sets_;
+  }
+  bool supported_by_runtime_system() const noexcept;
+
+  // The number of bytes classified by classify_structural_block, at most 64.
+  size_t structural_block_size() const noexcept { return block_size_; }
+
+  /**
+   * Classifies the `length` bytes starting at `block`, with `length` at most
+   * structural_block_size(). The bits past the end of the block are zero.
+   */
+  virtual void classify_structural_block(
+      const char* block, size_t length,
+      structural_masks& masks) const noexcept = 0;
+  // Same as http_tokens_map.
+  virtual uint8_t http_tokens_map(std::string_view view) const noexcept = 0;
+  // Same as contains_only_http_quoted_string_tokens.
+  virtual bool contains_only_http_quoted_string_tokens(
+      std::string_view view) const noexcept = 0;
+  // Same as to_lower_ascii.
+  virtual bool to_lower_ascii(char* input, size_t length) const noexcept = 0;
+
+ protected:
+  constexpr implementation(std::string_view name, std::string_view description,
+                           uint32_t required_instruction_sets,
+                           size_t block_size) noexcept
+      : name_(name),
+        description_(description),
+        required_instruction_sets_(required_instruction_sets),
+        block_size_(block_size) {}
+
+ private:
+  std::string_view name_;
+  std::string_view description_;
+  uint32_t required_instruction_sets_;
+  size_t block_size_;
+};
+
+/**
+ * Returns the implementation used by the parser. Unless one was set with
+ * set_active_implementation, it is the best one supported by the processor,
+ * or the one named by the ADA_MIMESNIFF_FORCE_IMPLEMENTATION environment
+ * variable.
+ */
+const implementation* get_active_implementation() noexcept;
+
+/**
+ * Makes the parser use the given implementation in every thread. Returns false
+ * and changes nothing if it is null or not supported by the processor.
+ */
+bool set_active_implementation(const implementation* impl) noexcept;
+
+/**
+ * Every implementation compiled in the library, supported or not, from the
+ * most portable to the fastest.
+ */
+const std::vector<const implementation*>& get_available_implementations();
+
+/**
+ * Returns the implementation with that name, or null if it is not compiled
+ * in the library.
+ */
+const implementation* get_implementation(std::string_view name) noexcept;
+
+}  // namespace ada::mimesniff
+
+#endif  // ADA_MIMESNIFF_IMPLEMENTATION_H
@@ -0,0 +1,324 @@
+#ifndef ADA_MIMESNIFF_LAZY_MIMETYPE_H
+#define ADA_MIMESNIFF_LAZY_MIMETYPE_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "ada/mimesniff/essence.h"
+#include "ada/mimesniff/parameter_name.h"
+#include "ada/mimesniff/parameter_name_set.h"
+#include "ada/mimesniff/parser-inl.h"
+#include "ada/mimesniff/scanner.h"
+#include "ada/mimesniff/util-inl.h"
+#include "ada/mimesniff/util.h"
+
+namespace ada::mimesniff {
+
+/**
+ * A parameter of a `lazy_mimetype`, as views into the input. Nothing is
+ * lowercased or unescaped until asked for.
+ */
+class lazy_parameter {
+ public:
+  lazy_parameter() = default;
+  explicit lazy_parameter(const raw_mime_type_parameter &raw) noexcept
+      : raw_(raw) {}
+
+  // The name as it appears in the input, in any ASCII case.
+  std::string_view raw_name() const noexcept { return raw_.name; }
+
+  // Returns true if the name, in ASCII lowercase, is the given one.
+  bool has_name(std::string_view lowercase_name) const noexcept {
+    return equals_ignoring_ascii_case(raw_.name, lowercase_name);
+  }
+
+  // The id of the name, or parameter_name_id::unknown.
+  parameter_name_id name_id() const noexcept {
+    return lookup_parameter_name(raw_.name);
+  }
+
+  // The name in ASCII lowercase.
+  std::string name() const {
+    std::string out(raw_.name);
+    if (raw_.name_map & 4) {
+      to_lower_ascii(out.data(), out.size());
+    }
+    return out;
+  }
+
+  /**
+   * The value as it appears in the input, without the quotes. It is the
+   * value itself unless `escaped()`, in which case it still holds U+005C (\)
+   * escapes.
+   */
+  std::string_view raw_value() const noexcept { return raw_.value; }
+
+  bool escaped() const noexcept { return raw_.escaped; }
+
+  // The value, unescaped.
+  std::string value() const {
+    if (!raw_.escaped) {
+      return std::string(raw_.value);
+    }
+    std::string out(raw_.value.size(), '\0');
+    out.resize(unescape_http_quoted_string(raw_.value, out.data()));
+    return out;
+  }
+
+  /**
+   * The value, unescaped into `storage` only if it has escapes. Otherwise
+   * the result is a view into the input and `storage` is left alone.
+   */
+  std::string_view value(std::string &storage) const {
+    if (!raw_.escaped) {
+      return raw_.value;
+    }
+    storage.resize(raw_.value.size());
+    storage.resize(unescape_http_quoted_string(raw_.value, storage.data()));
+    return storage;
+  }
+
+  /**
+   * Writes the unescaped value to output, which must hold raw_value().size()
+   * bytes, and returns its size.
+   */
+  size_t value_to(char *output) const noexcept {
+    return unescape_http_quoted_string(raw_.value, output);
+  }
+
+ private:
+  raw_mime_type_parameter raw_{};
+};
+
+/**
+ * Steps through the parameters of a `lazy_mimetype`, parsing each one when
+ * it is reached. It yields the parameters that `parse_mime_type` keeps, in
+ * the same order: a parameter is skipped if its value does not solely contain
+ * HTTP quoted-string token code points once unescaped, or if a parameter with
+ * the same name was yielded before.
+ */
+class lazy_parameter_iterator {
+ public:
+  using iterator_category = std::forward_iterator_tag;
+  using value_type = lazy_parameter;
+  using difference_type = std::ptrdiff_t;
+  using pointer = const lazy_parameter *;
+  using reference = const lazy_parameter &;
+
+  // The end of any list of parameters.
+  lazy_parameter_iterator() noexcept : scanner_(std::string_view()) {}
+
+  explicit lazy_parameter_iterator(std::string_view tail)
+      : tail_(tail), scanner_(tail), position_(0) {
+    advance();
+  }
+
+  // A copy gets its own set of names, so that copies can be advanced on
+  // different threads.
+  lazy_parameter_iterator(const lazy_parameter_iterator &other)
+      : tail_(other.tail_),
+        scanner_(other.scanner_),
+        position_(other.position_),
+        next_(other.next_),
+        current_(other.current_),
+        yielded_(other.yielded_),
+        yielded_count_(other.yielded_count_),
+        names_(other.names_
+                   ? std::make_unique<parameter_name_set>(*other.names_)
+                   : nullptr) {}
+
+  lazy_parameter_iterator(lazy_parameter_iterator &&) noexcept = default;
+
+  lazy_parameter_iterator &operator=(const lazy_parameter_iterator &other) {
+    if (this != &other) {
+      lazy_parameter_iterator copy(other);
+      *this = std::move(copy);
+    }
+    return *this;
+  }
+
+  lazy_parameter_iterator &operator=(lazy_parameter_iterator &&) noexcept =
+      default;
+
+  ~lazy_parameter_iterator() = default;
+
+  reference operator*() const noexcept { return current_; }
+  pointer operator->() const noexcept { return &current_; }
+
+  lazy_parameter_iterator &operator++() {
+    advance();
+    return *this;
+  }
+
+  lazy_parameter_iterator operator++(int) {
+    lazy_parameter_iterator copy = *this;
+    advance();
+    return copy;
+  }
+
+  bool operator==(const lazy_parameter_iterator &other) const noexcept {
+    return position_ == other.position_;
+  }
+  bool operator!=(const lazy_parameter_iterator &other) const noexcept {
+    return position_ != other.position_;
+  }
+
+ private:
+  static constexpr size_t end_position = ~size_t(0);
+  static constexpr size_t linear_threshold =
+      parameter_name_set::linear_threshold;
+
+  static bool is_valid(const raw_mime_type_parameter &p) noexcept {
+    return p.escaped ? escaped_contains_only_http_quoted_string_tokens(p.value)
+                     : contains_only_http_quoted_string_tokens(p.value);
+  }
+
+  void advance() {
+    raw_mime_type_parameter p{};
+    while (next_mime_type_parameter(tail_, scanner_, next_, p)) {
+      if (!is_valid(p) || was_yielded(p.name)) {
+        continue;
+      }
+      remember(p.name);
+      current_ = lazy_parameter(p);
+      position_ = next_;
+      return;
+    }
+    position_ = end_position;
+  }
+
+  bool was_yielded(std::string_view name) const noexcept {
+    if (yielded_count_ <= linear_threshold) {
+      for (size_t i = 0; i < yielded_count_; i++) {
+        if (ascii_case_insensitive_equals(yielded_[i], name)) {
+          return true;
+        }
+      }
+      return false;
+    }
+    return names_->contains(name);
+  }
+
+  /**
+   * The first names are kept in the iterator. Past them, they go to a hash
+   * set, so that iterating stays linear. Copying the iterator then copies
+   * the set.
+   */
+  void remember(std::string_view name) {
+    if (yielded_count_ < linear_threshold) {
+      yielded_[yielded_count_++] = name;
+      return;
+    }
+    if (yielded_count_++ == linear_threshold) {
+      names_ = std::make_unique<parameter_name_set>();
+      for (std::string_view yielded : yielded_) {
+        names_->insert(yielded);
+      }
+    }
+    names_->insert(name);
+  }
+
+  std::string_view tail_{};
+  structural_scanner scanner_;
+  // Where the current parameter ends, or end_position.
+  size_t position_{end_position};
+  // Where to resume parsing.
+  size_t next_{0};
+  lazy_parameter current_{};
+  std::array<std::string_view, linear_threshold> yielded_{};
+  size_t yielded_count_{0};
+  std::unique_ptr<parameter_name_set> names_{};
+};
+
+// The parameters of a `lazy_mimetype`, parsed as they are iterated over.
+struct lazy_parameter_list {
+  std::string_view tail{};
+
+  lazy_parameter_iterator begin() const {
+    return lazy_parameter_iterator(tail);
+  }
+  lazy_parameter_iterator end() const noexcept { return {}; }
+};
+
+/**
+ * A MIME type whose essence is validated up front and whose parameters are
+ * left unparsed, as views into the input, until they are looked at. The
+ * input must outlive the record. Most callers only need the essence, or a
+ * single parameter such as `charset`, which this finds without copying or
+ * lowercasing the others.
+ *
+ * The essence is not copied either when it is well-known, since it is then
+ * one of `essence_names`, or already in ASCII lowercase.
+ */
+class lazy_mimetype {
+ public:
+  lazy_mimetype() = default;
+
+  // The type, in ASCII lowercase.
+  std::string_view type() const noexcept {
+    return essence().substr(0, type_length_);
+  }
+
+  // The subtype, in ASCII lowercase.
+  std::string_view subtype() const noexcept {
+    return essence().substr(type_length_ + 1);
+  }
+
+  // The essence of a MIME type mimeType is mimeType’s type, followed by U+002F
+  // (/), followed by mimeType’s subtype.
+  std::string_view essence() const noexcept {
+    return lowered_essence_.empty() ? essence_
+                                    : std::string_view(lowered_essence_);
+  }
+
+  // The id of the essence, or essence_id::unknown if it is not a well-known
+  // one.
+  essence_id id() const noexcept { return essence_id_; }
+
+  // The parameters that parse_mime_type keeps, in the same order.
+  lazy_parameter_list parameters() const noexcept { return {tail_}; }
+
+  /**
+   * Returns the parameter with the given (lowercase) name. Parsing stops at
+   * the first match: the first parameter with a valid value is the one kept,
+   * so no duplicate has to be looked for.
+   */
+  std::optional<lazy_parameter> get_parameter(
+      std::string_view name) const noexcept {
+    structural_scanner scanner(tail_);
+    size_t position = 0;
+    raw_mime_type_parameter p{};
+    while (next_mime_type_parameter(tail_, scanner, position, p)) {
+      if (equals_ignoring_ascii_case(p.name, name) &&
+          (p.escaped
+               ? escaped_contains_only_http_quoted_string_tokens(p.value)
+               : contains_only_http_quoted_string_tokens(p.value))) {
+        return lazy_parameter(p);
+      }
+    }
+    return std::nullopt;
+  }
+
+ private:
+  friend std::optional<lazy_mimetype> parse_mime_type_lazy(
+      std::string_view input);
+
+  // A view into the input or into essence_names.
+  std::string_view essence_{};
+  // Set instead when the essence has to be lowercased.
+  std::string lowered_essence_{};
+  size_t type_length_{0};
+  essence_id essence_id_{essence_id::unknown};
+  // From the first U+003B (;) after the subtype to the end of the input.
+  std::string_view tail_{};
+};
+
+}  // namespace ada::mimesniff
+
+#endif  // ADA_MIMESNIFF_LAZY_MIMETYPE_H
@@ -2,70 +2,441 @@
 #define ADA_MIMESNIFF_MIMETYPE_H
 
 #include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <memory_resource>
+#include <optional>
 #include <string>
 #include <string_view>
-#include <vector>
+#include <utility>
 
+#include "ada/mimesniff/essence.h"
+#include "ada/mimesniff/parameter_name.h"
 #include "ada/mimesniff/util-inl.h"
 #include "ada/mimesniff/util.h"
 
 namespace ada::mimesniff {
 
-struct mimetype {
-  mimetype() = default;
-  mimetype(const mimetype &m) = default;
-  mimetype(mimetype &&m) noexcept = default;
-  mimetype &operator=(mimetype &&m) noexcept = default;
-  mimetype &operator=(const mimetype &m) = default;
-  ~mimetype() = default;
+// Copies the bytes to output and returns the end of the copy.
+constexpr inline char *copy_bytes(char *output,
+                                  std::string_view bytes) noexcept {
+  if (is_constant_evaluated()) {
+    for (char c : bytes) {
+      *output++ = c;
+    }
+    return output;
+  }
+  if (!bytes.empty()) {
+    std::memcpy(output, bytes.data(), bytes.size());
+  }
+  return output + bytes.size();
+}
+
+// A parameter value is serialized as an HTTP quoted string unless it is a
+// non-empty HTTP token.
+constexpr inline bool needs_quoting(std::string_view value) noexcept {
+  return value.empty() || !contains_only_http_tokens(value);
+}
+
+/**
+ * Returns the exact number of bytes of the serialization of a MIME type given
+ * its components. The parameters are any range of pairs whose members convert
+ * to std::string_view.
+ * @see https://mimesniff.spec.whatwg.org/#serializing-a-mime-type
+ */
+template <typename parameter_range>
+constexpr size_t serialized_mime_type_size(
+    std::string_view type, std::string_view subtype,
+    const parameter_range &parameters) noexcept {
+  size_t size = type.size() + 1 + subtype.size();
+  for (const auto &i : parameters) {
+    std::string_view name = i.first;
+    std::string_view value = i.second;
+    size += 2 + name.size() + value.size();  // ";name=value"
+    if (needs_quoting(value)) {
+      size += 2;
+      for (char c : value) {
+        size += (c == '"' || c == '\\');
+      }
+    }
+  }
+  return size;
+}
+
+/**
+ * Writes the serialization of a MIME type given its components to output,
+ * which must hold at least serialized_mime_type_size(...) bytes, and returns
+ * the end of what was written.
+ */
+template <typename parameter_range>
+constexpr char *write_serialized_mime_type(
+    char *output, std::string_view type, std::string_view subtype,
+    const parameter_range &parameters) noexcept {
+  output = copy_bytes(output, type);
+  *output++ = '/';
+  output = copy_bytes(output, subtype);
+  for (const auto &i : parameters) {
+    std::string_view name = i.first;
+    std::string_view value = i.second;
+    *output++ = ';';
+    output = copy_bytes(output, name);
+    *output++ = '=';
+    if (!needs_quoting(value)) {
+      output = copy_bytes(output, value);
+      continue;
+    }
+    *output++ = '"';
+    // Precede each occurrence of U+0022 (") or U+005C (\) in value with
+    // U+005C (\). The runs in between are copied at once.
+    size_t run_start = 0;
+    for (size_t j = 0; j < value.size(); j++) {
+      if (value[j] == '"' || value[j] == '\\') {
+        output = copy_bytes(output, value.substr(run_start, j - run_start));
+        *output++ = '\\';
+        run_start = j;
+      }
+    }
+    output = copy_bytes(output, value.substr(run_start));
+    *output++ = '"';
+  }
+  return output;
+}
+
+/**
+ * Serializes a MIME type given its components into output if the result fits
+ * in `capacity` bytes. Returns the size of the serialization in any case;
+ * nothing is written when it is larger than `capacity`.
+ */
+template <typename parameter_range>
+constexpr size_t serialize_mime_type_to(
+    char *output, size_t capacity, std::string_view type,
+    std::string_view subtype, const parameter_range &parameters) noexcept {
+  size_t size = serialized_mime_type_size(type, subtype, parameters);
+  if (size <= capacity) {
+    write_serialized_mime_type(output, type, subtype, parameters);
+  }
+  return size;
+}
+
+// Appends the serialization of a MIME type given its components to output,
+// growing it at most once.
+template <typename parameter_range>
+void append_serialized_mime_type(std::string &output, std::string_view type,
+                                 std::string_view subtype,
+                                 const parameter_range &parameters) {
+  size_t start = output.size();
+  output.resize(start + serialized_mime_type_size(type, subtype, parameters));
+  write_serialized_mime_type(output.data() + start, type, subtype, parameters);
+}
+
+/**
+ * Serializes a MIME type given its components. The parameters are any range
+ * of pairs whose members convert to std::string_view.
+ * @see https://mimesniff.spec.whatwg.org/#serializing-a-mime-type
+ */
+template <typename parameter_range>
+std::string serialize_mime_type(std::string_view type, std::string_view subtype,
+                                const parameter_range &parameters) noexcept {
+  std::string base{};
+  append_serialized_mime_type(base, type, subtype, parameters);
+  return base;
+}
+
+/**
+ * A forward iterator over parameters packed as "\0name\0value" one after
+ * the other, in insertion order. It is usable in constant expressions.
+ *
+ * A common name may be packed as the single byte of its parameter_name_id.
+ * It is then yielded as the static string `to_string(id)`, so comparing
+ * the data() of a name with that of `to_string(id)` tells whether it is
+ * that name.
+ */
+class packed_parameter_iterator {
+ public:
+  using iterator_category = std::forward_iterator_tag;
+  using value_type = std::pair<std::string_view, std::string_view>;
+  using difference_type = std::ptrdiff_t;
+  using pointer = const value_type *;
+  using reference = const value_type &;
+
+  constexpr packed_parameter_iterator() = default;
+  constexpr explicit packed_parameter_iterator(std::string_view tail) noexcept
+      : tail_(tail) {
+    load();
+  }
+
+  constexpr reference operator*() const noexcept { return current_; }
+  constexpr pointer operator->() const noexcept { return &current_; }
+
+  constexpr packed_parameter_iterator &operator++() noexcept {
+    tail_.remove_prefix(packed_size_);
+    load();
+    return *this;
+  }
+
+  constexpr packed_parameter_iterator operator++(int) noexcept {
+    packed_parameter_iterator copy = *this;
+    ++*this;
+    return copy;
+  }
+
+  constexpr bool operator==(
+      const packed_parameter_iterator &other) const noexcept {
+    return tail_.size() == other.tail_.size();
+  }
+  constexpr bool operator!=(
+      const packed_parameter_iterator &other) const noexcept {
+    return !(*this == other);
+  }
+
+ private:
+  constexpr void load() noexcept {
+    if (tail_.empty()) {
+      return;
+    }
+    // The tail starts with "\0name\0value".
+    size_t name_end = tail_.find('\0', 1);
+    size_t value_end = tail_.find('\0', name_end + 1);
+    if (value_end == std::string_view::npos) {
+      value_end = tail_.size();
+    }
+    // Member-wise, since std::pair cannot be assigned in a constant
+    // expression before C++20.
+    current_.first = tail_.substr(1, name_end - 1);
+    if (name_end == 2 && uint8_t(tail_[1]) < parameter_name_id_count) {
+      current_.first = to_string(parameter_name_id(uint8_t(tail_[1])));
+    }
+    current_.second = tail_.substr(name_end + 1, value_end - name_end - 1);
+    packed_size_ = value_end;
+  }
+
+  std::string_view tail_{};
+  value_type current_{};
+  // The size of the current parameter in the tail.
+  size_t packed_size_{0};
+};
+
+// Appends "\0name\0value" to a packed buffer, with a common name packed as
+// the byte of its parameter_name_id. The name is in ASCII lowercase.
+template <typename string_type>
+void append_packed_parameter(string_type &data, std::string_view name,
+                             std::string_view value) {
+  data += '\0';
+  parameter_name_id id = lookup_parameter_name(name);
+  if (id != parameter_name_id::unknown) {
+    data += char(id);
+  } else {
+    data += name;
+  }
+  data += '\0';
+  data += value;
+}
+
+// A read-only range over packed parameters.
+struct packed_parameter_list {
+  std::string_view tail{};
+  size_t count{};
+
+  constexpr packed_parameter_iterator begin() const noexcept {
+    return packed_parameter_iterator(tail);
+  }
+  constexpr packed_parameter_iterator end() const noexcept {
+    return packed_parameter_iterator(tail.substr(tail.size()));
+  }
+  constexpr size_t size() const noexcept { return count; }
+  constexpr bool empty() const noexcept { return count == 0; }
+};
+
+class parameter_name_set;
+
+/**
+ * A MIME type record. All of its canonical bytes are stored in a single
+ * buffer: the essence ("type/subtype") followed by, for each parameter, a NUL
+ * byte, the name, a NUL byte and the unescaped value. NUL can appear neither
+ * in a type, a subtype, a parameter name nor a parameter value, so it can be
+ * used as a separator. A record costs at most one allocation, and none when the
+ * buffer fits in the small-string storage.
+ *
+ * The buffer is allocated with the given allocator. Use `mimetype` for the
+ * default allocator and `pmr::mimetype` to allocate from a
+ * std::pmr::memory_resource.
+ */
+template <typename allocator = std::allocator<char>>
+class basic_mimetype {
+ public:
+  using allocator_type = allocator;
+  using string_type =
+      std::basic_string<char, std::char_traits<char>, allocator_type>;
+  using parameter = packed_parameter_iterator::value_type;
+
+  using parameter_iterator = packed_parameter_iterator;
+  using parameter_list = packed_parameter_list;
+
+  basic_mimetype() = default;
+  basic_mimetype(const basic_mimetype &m) = default;
+  basic_mimetype(basic_mimetype &&m) noexcept = default;
+  basic_mimetype &operator=(basic_mimetype &&m) = default;
+  basic_mimetype &operator=(const basic_mimetype &m) = default;
+  ~basic_mimetype() = default;
+
+  explicit basic_mimetype(const allocator_type &alloc) : data_(alloc) {}
+
+  /**
+   * Creates a record without parameters. The type and the subtype are stored
+   * as is: they are expected to be non-empty, in ASCII lowercase and to solely
+   * contain HTTP token code points.
+   */
+  basic_mimetype(std::string_view type, std::string_view subtype,
+                 const allocator_type &alloc = allocator_type())
+      : data_(alloc) {
+    data_.reserve(type.size() + 1 + subtype.size());
+    data_ += type;
+    data_ += '/';
+    data_ += subtype;
+    type_length_ = uint32_t(type.size());
+    essence_length_ = uint32_t(data_.size());
+    essence_id_ = lookup_essence(type, subtype);
+  }
 
   // A MIME type’s type is a non-empty ASCII string.
-  std::string type{};
+  std::string_view type() const noexcept {
+    return std::string_view(data_).substr(0, type_length_);
+  }
 
   // A MIME type’s subtype is a non-empty ASCII string.
-  std::string subtype{};
+  std::string_view subtype() const noexcept {
+    return std::string_view(data_).substr(
+        type_length_ + 1, essence_length_ - type_length_ - 1);
+  }
+
+  // The essence of a MIME type mimeType is mimeType’s type, followed by U+002F
+  // (/), followed by mimeType’s subtype.
+  std::string_view essence() const noexcept {
+    return std::string_view(data_).substr(0, essence_length_);
+  }
+
+  // The id of the essence, or essence_id::unknown if it is not a well-known
+  // one. Switching on it is cheaper than comparing essence() to strings.
+  essence_id id() const noexcept { return essence_id_; }
 
   // A MIME type’s parameters is an ordered map whose keys are ASCII
   // strings and values are strings limited to HTTP quoted-string token code
   // points. It is initially empty.
-  std::vector<std::pair<std::string, std::string>> parameters{};
+  parameter_list parameters() const noexcept {
+    return {std::string_view(data_).substr(essence_length_), parameter_count_};
+  }
 
-  // The essence of a MIME type mimeType is mimeType’s type, followed by U+002F
-  // (/), followed by mimeType’s subtype.
-  std::string essence() const noexcept { return type + "/" + subtype; }
+  // Returns the value of the parameter with the given (lowercase) name.
+  std::optional<std::string_view> get_parameter(
+      std::string_view name) const noexcept {
+    parameter_name_id id = lookup_parameter_name(name);
+    if (id != parameter_name_id::unknown) {
+      return get_parameter(id);
+    }
+    for (const parameter &p : parameters()) {
+      if (p.first == name) {
+        return p.second;
+      }
+    }
+    return std::nullopt;
+  }
+
+  // Returns the value of the parameter with a common name. A common name is
+  // always packed as its id and yielded as the static string of the id, so
+  // this compares pointers.
+  std::optional<std::string_view> get_parameter(
+      parameter_name_id id) const noexcept {
+    const char *name = to_string(id).data();
+    for (const parameter &p : parameters()) {
+      if (p.first.data() == name) {
+        return p.second;
+      }
+    }
+    return std::nullopt;
+  }
 
   /**
-   * @see https://mimesniff.spec.whatwg.org/#serializing-a-mime-type
+   * Sets the parameter with the given name to value, replacing the previous
+   * value in place if the parameter exists and appending it otherwise. The
+   * name is expected to be in ASCII lowercase and to solely contain HTTP token
+   * code points, the value to solely contain HTTP quoted-string token code
+   * points.
    */
-  std::string serialized() const noexcept {
-    std::string base = type + "/" + subtype;
-
-    for (const auto &i : parameters) {
-      base += ';';
-      base += i.first + "=";
-      if (i.second.empty() || !contains_only_http_tokens(i.second)) {
-        // Precede each occurrence of U+0022 (") or U+005C (\) in value with
-        // U+005C (\).
-        base += '\"';
-        for (char c : i.second) {
-          switch (c) {
-            case '"':
-            case '\\':
-              base += '\\';
-              [[fallthrough]];
-            default:
-              base += c;
-          }
-        }
-        base += '\"';
-      } else {
-        base += i.second;
+  void set_parameter(std::string_view name, std::string_view value) {
+    for (const parameter &p : parameters()) {
+      if (p.first == name) {
+        data_.replace(size_t(p.second.data() - data_.data()), p.second.size(),
+                      value);
+        return;
       }
     }
-    return base;
+    append_parameter(name, value);
   }
+
+  /**
+   * @see https://mimesniff.spec.whatwg.org/#serializing-a-mime-type
+   */
+  std::string serialized() const noexcept {
+    return serialize_mime_type(type(), subtype(), parameters());
+  }
+
+  // The exact size of serialized().
+  size_t serialized_size() const noexcept {
+    return serialized_mime_type_size(type(), subtype(), parameters());
+  }
+
+  /**
+   * Writes the serialization to output if it fits in `capacity` bytes and
+   * returns its size. Nothing is written when it does not fit.
+   */
+  size_t serialize_to(char *output, size_t capacity) const noexcept {
+    return serialize_mime_type_to(output, capacity, type(), subtype(),
+                                  parameters());
+  }
+
+  // Appends the serialization to output, growing it at most once.
+  void serialize_to(std::string &output) const {
+    append_serialized_mime_type(output, type(), subtype(), parameters());
+  }
+
+  // The number of bytes allocated by the record, if any.
+  size_t heap_usage() const noexcept {
+    return data_.capacity() > string_type().capacity() ? data_.capacity() + 1
+                                                        : 0;
+  }
+
+  allocator_type get_allocator() const noexcept {
+    return data_.get_allocator();
+  }
+
+ private:
+  template <typename record>
+  friend struct mimetype_builder;
+  template <typename record>
+  friend bool parse_mime_type_into_impl(record &out, std::string_view input,
+                                        parameter_name_set &names);
+
+  void append_parameter(std::string_view name, std::string_view value) {
+    append_packed_parameter(data_, name, value);
+    parameter_count_++;
+  }
+
+  string_type data_{};
+  uint32_t type_length_{0};
+  uint32_t essence_length_{0};
+  uint32_t parameter_count_{0};
+  essence_id essence_id_{essence_id::unknown};
 };
 
+using mimetype = basic_mimetype<>;
+
+namespace pmr {
+using mimetype = basic_mimetype<std::pmr::polymorphic_allocator<char>>;
+}  // namespace pmr
+
 }  // namespace ada::mimesniff
 
 #endif  // ADA_MIMESNIFF_MIMETYPE_H
@@ -0,0 +1,201 @@
+#ifndef ADA_MIMESNIFF_MIMETYPE_VIEW_H
+#define ADA_MIMESNIFF_MIMETYPE_VIEW_H
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "ada/mimesniff/mimetype.h"
+
+namespace ada::mimesniff {
+
+/**
+ * A parsed MIME type whose components are views. A component points into the
+ * input given to `parse_mime_type_view` whenever the spec leaves its bytes
+ * unchanged, so the input must outlive the view. Only the components that have
+ * to be lowercased or unescaped are copied, into a single buffer owned by the
+ * view. Up to `inline_parameter_capacity` parameters are stored inline, so
+ * parsing an input such as "text/html; charset=utf-8" does not allocate.
+ */
+class mimetype_view {
+ public:
+  using parameter = std::pair<std::string_view, std::string_view>;
+
+  // The number of parameters that are stored without allocating.
+  static constexpr size_t inline_parameter_capacity = 4;
+
+  // A contiguous, read-only range over the parameters.
+  struct parameter_list {
+    const parameter *first{};
+    size_t count{};
+
+    const parameter *begin() const noexcept { return first; }
+    const parameter *end() const noexcept { return first + count; }
+    size_t size() const noexcept { return count; }
+    bool empty() const noexcept { return count == 0; }
+    const parameter &operator[](size_t i) const noexcept { return first[i]; }
+  };
+
+  mimetype_view() = default;
+  mimetype_view(const mimetype_view &m) { *this = m; }
+  mimetype_view(mimetype_view &&m) noexcept = default;
+  mimetype_view &operator=(mimetype_view &&m) noexcept = default;
+  mimetype_view &operator=(const mimetype_view &m);
+  ~mimetype_view() = default;
+
+  // The type, in ASCII lowercase.
+  std::string_view type() const noexcept { return type_; }
+
+  // The subtype, in ASCII lowercase.
+  std::string_view subtype() const noexcept { return subtype_; }
+
+  // The parameters in insertion order. Names are in ASCII lowercase and values
+  // are unescaped.
+  parameter_list parameters() const noexcept {
+    return {parameter_count_ > inline_parameter_capacity
+                ? overflow_parameters_.data()
+                : inline_parameters_.data(),
+            parameter_count_};
+  }
+
+  // Returns the value of the parameter with the given (lowercase) name.
+  std::optional<std::string_view> get_parameter(
+      std::string_view name) const noexcept {
+    for (const parameter &p : parameters()) {
+      if (p.first == name) {
+        return p.second;
+      }
+    }
+    return std::nullopt;
+  }
+
+  // Returns the value of the parameter with a common name. A common name is
+  // always the static string of its id, so this compares pointers.
+  std::optional<std::string_view> get_parameter(
+      parameter_name_id id) const noexcept {
+    const char *name = to_string(id).data();
+    for (const parameter &p : parameters()) {
+      if (p.first.data() == name) {
+        return p.second;
+      }
+    }
+    return std::nullopt;
+  }
+
+  // The essence of a MIME type mimeType is mimeType’s type, followed by U+002F
+  // (/), followed by mimeType’s subtype.
+  std::string essence() const noexcept {
+    std::string base{type_};
+    base += '/';
+    base += subtype_;
+    return base;
+  }
+
+  // The id of the essence, or essence_id::unknown if it is not a well-known
+  // one.
+  essence_id id() const noexcept { return essence_id_; }
+
+  /**
+   * @see https://mimesniff.spec.whatwg.org/#serializing-a-mime-type
+   */
+  std::string serialized() const noexcept {
+    return serialize_mime_type(type_, subtype_, parameters());
+  }
+
+  // The exact size of serialized().
+  size_t serialized_size() const noexcept {
+    return serialized_mime_type_size(type_, subtype_, parameters());
+  }
+
+  /**
+   * Writes the serialization to output if it fits in `capacity` bytes and
+   * returns its size. Nothing is written when it does not fit.
+   */
+  size_t serialize_to(char *output, size_t capacity) const noexcept {
+    return serialize_mime_type_to(output, capacity, type_, subtype_,
+                                  parameters());
+  }
+
+  // Appends the serialization to output, growing it at most once.
+  void serialize_to(std::string &output) const {
+    append_serialized_mime_type(output, type_, subtype_, parameters());
+  }
+
+  // Returns an owning copy that no longer depends on the input.
+  mimetype to_mimetype() const {
+    mimetype out(type_, subtype_);
+    for (const parameter &p : parameters()) {
+      out.set_parameter(p.first, p.second);
+    }
+    return out;
+  }
+
+ private:
+  friend struct mimetype_view_builder;
+
+  void add_parameter(std::string_view name, std::string_view value) {
+    if (parameter_count_ < inline_parameter_capacity) {
+      inline_parameters_[parameter_count_++] = {name, value};
+      return;
+    }
+    if (parameter_count_ == inline_parameter_capacity) {
+      overflow_parameters_.assign(inline_parameters_.begin(),
+                                  inline_parameters_.end());
+    }
+    overflow_parameters_.emplace_back(name, value);
+    parameter_count_++;
+  }
+
+  // Makes a view that points into `from`'s buffer point into ours instead.
+  std::string_view rebase(std::string_view view,
+                          const mimetype_view &from) const noexcept {
+    const char *base = from.buffer_.get();
+    if (base == nullptr || std::less<const char *>{}(view.data(), base) ||
+        !std::less<const char *>{}(view.data(), base + from.buffer_size_)) {
+      return view;
+    }
+    return {buffer_.get() + (view.data() - base), view.size()};
+  }
+
+  std::string_view type_{};
+  std::string_view subtype_{};
+  essence_id essence_id_{essence_id::unknown};
+  std::array<parameter, inline_parameter_capacity> inline_parameters_{};
+  // Holds all the parameters once there are more than fit inline.
+  std::vector<parameter> overflow_parameters_{};
+  size_t parameter_count_{0};
+  // The lowercased and unescaped bytes. It is never larger than the input.
+  std::unique_ptr<char[]> buffer_{};
+  size_t buffer_size_{0};
+};
+
+inline mimetype_view &mimetype_view::operator=(const mimetype_view &m) {
+  if (this == &m) {
+    return *this;
+  }
+  buffer_size_ = m.buffer_size_;
+  buffer_.reset();
+  if (m.buffer_) {
+    buffer_ = std::make_unique<char[]>(buffer_size_);
+    std::copy(m.buffer_.get(), m.buffer_.get() + buffer_size_, buffer_.get());
+  }
+  type_ = rebase(m.type_, m);
+  subtype_ = rebase(m.subtype_, m);
+  essence_id_ = m.essence_id_;
+  parameter_count_ = 0;
+  overflow_parameters_.clear();
+  for (const parameter &p : m.parameters()) {
+    add_parameter(rebase(p.first, m), rebase(p.second, m));
+  }
+  return *this;
+}
+
+}  // namespace ada::mimesniff
+
+#endif  // ADA_MIMESNIFF_MIMETYPE_VIEW_H
@@ -0,0 +1,102 @@
+#ifndef ADA_MIMESNIFF_PARALLEL_H
+#define ADA_MIMESNIFF_PARALLEL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "ada/mimesniff/mimetype.h"
+
+namespace ada::mimesniff {
+
+/**
+ * Runs `task(i)` for every i in [0, task_count), possibly concurrently, and
+ * returns once all of them have completed. Any thread pool can be adapted to
+ * this signature.
+ */
+using executor = std::function<void(
+    size_t task_count, const std::function<void(size_t)>& task)>;
+
+/**
+ * A fixed set of threads that run the tasks of one job at a time. Each thread
+ * starts with a contiguous range of the tasks and, once it is done, steals
+ * the second half of the range of another thread, so uneven tasks still keep
+ * every thread busy. The calling thread takes part in the work.
+ */
+class thread_pool {
+ public:
+  // The pool uses `thread_count` threads including the caller of run.
+  explicit thread_pool(size_t thread_count = default_thread_count());
+  ~thread_pool();
+  thread_pool(const thread_pool&) = delete;
+  thread_pool& operator=(const thread_pool&) = delete;
+
+  size_t thread_count() const noexcept { return range_count_; }
+
+  // Same contract as `executor`. Concurrent calls are run one after another.
+  void run(size_t task_count, const std::function<void(size_t)>& task);
+
+  // The number of hardware threads, at least 1.
+  static size_t default_thread_count() noexcept;
+
+ private:
+  // The tasks [next, end) not yet taken from one thread. Each range has its
+  // own cache line so the threads never write to a shared one.
+  struct alignas(64) task_range {
+    std::mutex mutex{};
+    size_t next{0};
+    size_t end{0};
+  };
+
+  void worker_loop(size_t index);
+  void work(size_t index, const std::function<void(size_t)>& task);
+  bool pop(size_t index, size_t& task_index);
+  bool steal(size_t index);
+
+  size_t range_count_;
+  std::unique_ptr<task_range[]> ranges_;
+  std::vector<std::thread> threads_{};
+  std::mutex run_mutex_{};
+  std::mutex mutex_{};
+  std::condition_variable wake_{};
+  std::condition_variable done_{};
+  const std::function<void(size_t)>* task_{nullptr};
+  uint64_t generation_{0};
+  size_t busy_{0};
+  bool stop_{false};
+  std::atomic<size_t> remaining_{0};
+};
+
+/**
+ * The number of inputs parsed by one task of parse_mime_types_parallel. It is
+ * a multiple of 64 so that every task writes whole words of the bitmap, and
+ * 512 records span whole cache lines, so the tasks never write to the same
+ * line when the arrays are 64-byte aligned.
+ */
+constexpr size_t parallel_chunk_size = 512;
+
+/**
+ * Same as parse_mime_types, with chunks of parallel_chunk_size inputs parsed
+ * concurrently by the executor, the given pool or a pool shared by the
+ * process with one thread per core. Reusing the records across calls keeps
+ * the threads away from the global allocator.
+ */
+size_t parse_mime_types_parallel(const std::string_view* inputs, size_t count,
+                                 mimetype* results, uint64_t* valid,
+                                 const executor& run);
+size_t parse_mime_types_parallel(const std::string_view* inputs, size_t count,
+                                 mimetype* results, uint64_t* valid,
+                                 thread_pool& pool);
+size_t parse_mime_types_parallel(const std::string_view* inputs, size_t count,
+                                 mimetype* results, uint64_t* valid);
+
+}  // namespace ada::mimesniff
+
+#endif  // ADA_MIMESNIFF_PARALLEL_H
@@ -0,0 +1,119 @@
+#ifndef ADA_MIMESNIFF_PARAMETER_NAME_H
+#define ADA_MIMESNIFF_PARAMETER_NAME_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#include "ada/mimesniff/util-inl.h"
+#include "ada/mimesniff/util.h"
+
+namespace ada::mimesniff {
+
+// The parameter names that nearly all parameters use, as (identifier, name)
+// pairs. Appending to the list is enough as long as the hash below stays
+// perfect, which is checked at compile time.
+#define ADA_MIMESNIFF_PARAMETER_NAMES(X) \
+  X(charset, "charset")                  \
+  X(boundary, "boundary")                \
+  X(codecs, "codecs")                    \
+  X(profile, "profile")                  \
+  X(q, "q")                              \
+  X(version, "version")                  \
+  X(format, "format")
+
+/**
+ * A small integer naming a common parameter name. The parsed records store it
+ * in place of the name, as a single byte below U+0021 (!) which no HTTP token
+ * contains, so that it is neither copied nor lowercased, and looking a
+ * parameter up by id is an integer compare. Every other name maps to
+ * `unknown` and is stored as is.
+ */
+enum class parameter_name_id : uint8_t {
+  unknown = 0,
+#define ADA_MIMESNIFF_PARAMETER_NAME_ID(id, name) id,
+  ADA_MIMESNIFF_PARAMETER_NAMES(ADA_MIMESNIFF_PARAMETER_NAME_ID)
+#undef ADA_MIMESNIFF_PARAMETER_NAME_ID
+};
+
+// The names indexed by parameter_name_id. The entry of `unknown` is empty.
+constexpr inline std::string_view parameter_names[] = {
+    "",
+#define ADA_MIMESNIFF_PARAMETER_NAME(id, name) name,
+    ADA_MIMESNIFF_PARAMETER_NAMES(ADA_MIMESNIFF_PARAMETER_NAME)
+#undef ADA_MIMESNIFF_PARAMETER_NAME
+};
+
+constexpr inline size_t parameter_name_id_count =
+    sizeof(parameter_names) / sizeof(parameter_names[0]);
+static_assert(parameter_name_id_count <= 0x21,
+              "a parameter_name_id is stored as a byte below U+0021 (!)");
+
+// Returns the name named by the id, e.g. "charset".
+constexpr inline std::string_view to_string(parameter_name_id id) noexcept {
+  return parameter_names[size_t(id)];
+}
+
+/**
+ * A perfect hash of the common names on their first byte, with ASCII case
+ * folded, and their length. The table is filled at compile time.
+ */
+struct parameter_name_hash_table {
+  static constexpr size_t size = 16;
+  static constexpr size_t length_multiplier = 7;
+
+  // Whether every name has a slot of its own.
+  bool perfect{};
+  // The parameter_name_id of each slot, unknown when the slot is free.
+  uint8_t slots[size]{};
+
+  static constexpr size_t hash(std::string_view name) noexcept {
+    size_t first = uint8_t(name[0] | 0x20);
+    return (first + name.size() * length_multiplier) % size;
+  }
+};
+
+constexpr inline parameter_name_hash_table make_parameter_name_hash_table() {
+  parameter_name_hash_table table{};
+  table.perfect = true;
+  for (size_t id = 1; id < parameter_name_id_count; id++) {
+    size_t slot = parameter_name_hash_table::hash(parameter_names[id]);
+    if (table.slots[slot] != 0) {
+      table.perfect = false;
+    }
+    table.slots[slot] = uint8_t(id);
+  }
+  return table;
+}
+
+constexpr inline parameter_name_hash_table parameter_name_lookup =
+    make_parameter_name_hash_table();
+static_assert(parameter_name_lookup.perfect,
+              "two parameter names collide: update "
+              "parameter_name_hash_table::length_multiplier");
+
+/**
+ * Returns the id of a parameter name, in any ASCII case, or
+ * parameter_name_id::unknown.
+ */
+constexpr inline parameter_name_id lookup_parameter_name(
+    std::string_view name) noexcept {
+  if (name.empty()) {
+    return parameter_name_id::unknown;
+  }
+  uint8_t id =
+      parameter_name_lookup.slots[parameter_name_hash_table::hash(name)];
+  if (!equals_ignoring_ascii_case(name, parameter_names[id])) {
+    return parameter_name_id::unknown;
+  }
+  return parameter_name_id(id);
+}
+
+static_assert(lookup_parameter_name("Charset") == parameter_name_id::charset,
+              "lookup_parameter_name is broken");
+static_assert(lookup_parameter_name("chars") == parameter_name_id::unknown,
+              "lookup_parameter_name is broken");
+
+}  // namespace ada::mimesniff
+
+#endif  // ADA_MIMESNIFF_PARAMETER_NAME_H
@@ -0,0 +1,130 @@
+#ifndef ADA_MIMESNIFF_PARAMETER_NAME_SET_H
+#define ADA_MIMESNIFF_PARAMETER_NAME_SET_H
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <string_view>
+#include <vector>
+
+#include "ada/mimesniff/util-inl.h"
+
+namespace ada::mimesniff {
+
+/**
+ * A set of parameter names, compared ignoring ASCII case, so that telling
+ * whether a parameter is a duplicate stays linear in the number of
+ * parameters. The names are views: what they point to must outlive the set
+ * and must not move.
+ *
+ * Walking a handful of names beats hashing them, so the first
+ * `linear_threshold` names are kept inline and compared one by one. Nothing
+ * is allocated for typical MIME types. Past them, the names go to an
+ * open-addressing hash table, allocated from the memory resource of the set.
+ * Clearing the set keeps that storage, so a set reused from one input to the
+ * next stops allocating once it has held the most names.
+ */
+class parameter_name_set {
+ public:
+  static constexpr size_t linear_threshold = 8;
+
+  parameter_name_set() = default;
+  explicit parameter_name_set(std::pmr::memory_resource* resource)
+      : names_(resource), slots_(resource) {}
+
+  bool empty() const noexcept { return size_ == 0; }
+  size_t size() const noexcept { return size_; }
+
+  // Empties the set, keeping the storage of its hash table.
+  void clear() noexcept {
+    size_ = 0;
+    names_.clear();
+  }
+
+  // Returns true if a name equal to this one, ignoring ASCII case, is in the
+  // set.
+  bool contains(std::string_view name) const noexcept {
+    if (size_ <= linear_threshold) {
+      for (size_t i = 0; i < size_; i++) {
+        if (ascii_case_insensitive_equals(inline_names_[i], name)) {
+          return true;
+        }
+      }
+      return false;
+    }
+    size_t mask = slots_.size() - 1;
+    for (size_t i = hash(name) & mask;; i = (i + 1) & mask) {
+      if (slots_[i] == 0) {
+        return false;
+      }
+      if (ascii_case_insensitive_equals(names_[slots_[i] - 1], name)) {
+        return true;
+      }
+    }
+  }
+
+  // Adds a non-empty name that is not in the set.
+  void insert(std::string_view name) {
+    if (size_ < linear_threshold) {
+      inline_names_[size_++] = name;
+      return;
+    }
+    if (size_ == linear_threshold) {
+      // The inline names move to the table.
+      names_.assign(inline_names_.begin(), inline_names_.end());
+    }
+    names_.push_back(name);
+    size_++;
+    // At most half full, so that probes stay short.
+    if (size_ == linear_threshold + 1 || 2 * size_ > slots_.size()) {
+      rehash(std::max(4 * linear_threshold, 4 * size_));
+      return;
+    }
+    place(names_.size() - 1);
+  }
+
+ private:
+  // FNV-1a over the bytes in ASCII lowercase.
+  static size_t hash(std::string_view name) noexcept {
+    uint64_t h = 0xcbf29ce484222325;
+    for (char c : name) {
+      h = (h ^ uint8_t(to_lower_ascii_byte(c))) * 0x100000001b3;
+    }
+    return size_t(h ^ (h >> 32));
+  }
+
+  void place(size_t index) noexcept {
+    size_t mask = slots_.size() - 1;
+    size_t i = hash(names_[index]) & mask;
+    while (slots_[i] != 0) {
+      i = (i + 1) & mask;
+    }
+    slots_[i] = uint32_t(index + 1);
+  }
+
+  // Refills a table of `size` slots, a power of two. Its storage is only
+  // reallocated when it grows past its capacity.
+  void rehash(size_t size) {
+    size_t slots = 1;
+    while (slots < size) {
+      slots *= 2;
+    }
+    slots_.assign(slots, 0);
+    for (size_t i = 0; i < names_.size(); i++) {
+      place(i);
+    }
+  }
+
+  std::array<std::string_view, linear_threshold> inline_names_{};
+  // Past linear_threshold, every name, in order.
+  std::pmr::vector<std::string_view> names_{};
+  // One more than the index of a name in names_, 0 for a free slot.
+  std::pmr::vector<uint32_t> slots_{};
+  size_t size_{0};
+};
+
+}  // namespace ada::mimesniff
+
+#endif  // ADA_MIMESNIFF_PARAMETER_NAME_SET_H
@@ -0,0 +1,252 @@
+#ifndef ADA_MIMESNIFF_PARSER_INL_H
+#define ADA_MIMESNIFF_PARSER_INL_H
+
+#include <algorithm>
+#include <cstdint>
+#include <string_view>
+
+#include "ada/mimesniff/scanner.h"
+#include "ada/mimesniff/util-inl.h"
+#include "ada/mimesniff/util.h"
+
+namespace ada::mimesniff {
+
+// The type and subtype of a MIME type, as views into the input.
+struct raw_mime_type_essence {
+  std::string_view type{};
+  uint8_t type_map{0};
+  std::string_view subtype{};
+  uint8_t subtype_map{0};
+  // Where the parameters start: the first U+003B (;) or the end of the input.
+  size_t end{0};
+};
+
+// A parameter as it appears in the input.
+struct raw_mime_type_parameter {
+  // Non-empty and solely HTTP token code points, in any case.
+  std::string_view name{};
+  uint8_t name_map{0};
+  // When `escaped` is true, the raw content of an HTTP quoted string that
+  // contains at least one U+005C (\).
+  std::string_view value{};
+  bool escaped{false};
+};
+
+/**
+ * Collects the type and subtype of a MIME type from an input that has no
+ * leading or trailing HTTP whitespace. Returns false on failure.
+ */
+template <typename scanner_type>
+constexpr bool parse_mime_type_essence(std::string_view input,
+                                       scanner_type& scanner,
+                                       raw_mime_type_essence& out) {
+  size_t type_end_position = scanner.find(structural::slash, 0);
+  if (type_end_position == input.size()) {
+    return false;
+  }
+
+  // Let type be the result of collecting a sequence of code points that are not
+  // U+002F (/) from input, given position.
+  out.type = input.substr(0, type_end_position);
+  out.type_map = http_tokens_map(out.type);
+  // If type is the empty string or does not solely contain HTTP token code
+  // points, then return failure.
+  if (out.type.empty() || (out.type_map & 128)) {
+    return false;
+  }
+
+  // Skip past type and U+002F (/).
+  size_t position = type_end_position + 1;
+
+  // Let subtype be the result of collecting a sequence of code
+  // points that are not U+003B (;) from input, given position.
+  size_t subtype_end_position = scanner.find(structural::semicolon, position);
+  out.subtype = input.substr(position, subtype_end_position - position);
+
+  // Remove any trailing HTTP whitespace from subtype.
+  trim_trailing_http_whitespace(out.subtype);
+
+  out.subtype_map = http_tokens_map(out.subtype);
+
+  // If subtype is the empty string or does not solely contain
+  // HTTP token code points, then return failure.
+  if (out.subtype.empty() || (out.subtype_map & 128)) {
+    return false;
+  }
+
+  // Skip past subtype.
+  out.end = subtype_end_position;
+  return true;
+}
+
+/**
+ * Collects the next parameter whose name is non-empty and solely contains
+ * HTTP token code points, starting at `position`, which is at a U+003B (;) or
+ * at the end of the input. On success, `position` is left at the U+003B (;)
+ * that follows the parameter or at the end of the input. Returns false once
+ * there are no parameters left.
+ *
+ * The value is neither unescaped nor checked, and the parameter may be a
+ * duplicate: that is up to the caller.
+ */
+template <typename scanner_type>
+constexpr bool next_mime_type_parameter(std::string_view input,
+                                        scanner_type& scanner,
+                                        size_t& position,
+                                        raw_mime_type_parameter& out) {
+  // While position is not past the end of input:
+  while (position < input.size()) {
+    // Advance position by 1. (This skips past U+003B (;).)
+    position++;
+
+    // Collect a sequence of code points that are HTTP whitespace from input
+    // given position.
+    position = scanner.find_not(structural::whitespace, position);
+
+    // Let parameterName be the result of collecting a sequence of code points
+    // that are not U+003B (;) or U+003D (=) from input, given position.
+    size_t parameter_name_ending =
+        scanner.find(structural::semicolon | structural::equals, position);
+
+    if (parameter_name_ending == input.size()) {
+      // Parameter name needs to end with either `;` or `=`
+      // If position is past the end of input, then break.
+      position = input.size();
+      break;
+    }
+
+    std::string_view parameter_name =
+        input.substr(position, parameter_name_ending - position);
+    position = parameter_name_ending;
+
+    // If the code point at position within input is U+003B (;), then
+    // continue.
+    if (input[position] == ';') continue;
+
+    // Advance position by 1. (This skips past U+003D (=).)
+    position++;
+
+    // Let parameterValue be null.
+    std::string_view parameter_value{};
+    bool escaped = false;
+
+    // If the code point at position within input is U+0022 ("), then:
+    if (position < input.size() && input[position] == '"') {
+      // Set parameterValue to the result of collecting an HTTP quoted string
+      // from input. The escapes are left in place for the caller.
+      position++;
+      size_t end_index = position;
+      while (true) {
+        end_index = scanner.find(structural::quote | structural::backslash,
+                                 end_index);
+        if (end_index == input.size() || input[end_index] == '"') {
+          break;
+        }
+        escaped = true;
+        // Skip past the U+005C (\) and the code point it escapes, if any.
+        end_index = std::min(end_index + 2, input.size());
+      }
+      parameter_value = input.substr(position, end_index - position);
+      // Collect a sequence of code points that are not U+003B (;) from input,
+      // given position.
+      position = scanner.find(structural::semicolon, end_index);
+    } else {
+      // Set parameterValue to the result of collecting a sequence of code
+      // points that are not U+003B (;) from input, given position.
+      size_t semicolon_index = scanner.find(structural::semicolon, position);
+
+      parameter_value = input.substr(position, semicolon_index - position);
+
+      // Remove any trailing HTTP whitespace from parameterValue.
+      trim_trailing_http_whitespace(parameter_value);
+
+      // Collect a sequence of code points that are not U+003B (;) from input,
+      // given position.
+      position = semicolon_index;
+
+      // If parameterValue is the empty string, then continue.
+      if (parameter_value.empty()) {
+        continue;
+      }
+    }
+
+    // If all of the following are true
+    // - parameterName is not the empty string
+    // - parameterName solely contains HTTP token code points
+    // (the remaining conditions are checked by the caller)
+    uint8_t parameter_name_map = http_tokens_map(parameter_name);
+    if (!parameter_name.empty() && !(parameter_name_map & 128)) {
+      out = {parameter_name, parameter_name_map, parameter_value, escaped};
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * Walks the input following
+ * https://mimesniff.spec.whatwg.org/#parse-a-mime-type and reports the
+ * components to the handler as views into the input. Nothing is copied, the
+ * handler decides what needs to be lowercased, unescaped and stored.
+ *
+ * The handler must provide:
+ *
+ *   void on_essence(std::string_view type, uint8_t type_map,
+ *                   std::string_view subtype, uint8_t subtype_map);
+ *   void on_parameter(std::string_view name, uint8_t name_map,
+ *                     std::string_view value, bool escaped);
+ *
+ * The maps are the result of `http_tokens_map`. `on_parameter` is only called
+ * for parameter names that are non-empty and solely contain HTTP token code
+ * points. When `escaped` is true, `value` is the raw content of an HTTP quoted
+ * string that contains at least one U+005C (\) and must be unescaped with
+ * `unescape_http_quoted_string`. The handler still has to check that the value
+ * solely contains HTTP quoted-string token code points and that the parameter
+ * does not already exist.
+ *
+ * The scanner finds the structural bytes. The default one runs the kernels of
+ * the active implementation; with scalar_structural_scanner and a handler
+ * whose callbacks are constexpr, parsing can happen in a constant expression.
+ *
+ * Returns false on failure, in which case `on_essence` was not called, or as
+ * soon as the input has more than `max_parameters` parameters with a valid
+ * name, whether they end up being kept or not.
+ */
+template <typename scanner_type = structural_scanner, typename handler>
+constexpr bool parse_mime_type_components(
+    std::string_view input, handler& h,
+    size_t max_parameters = ~size_t(0)) {
+  // Remove any leading and trailing HTTP whitespace from input.
+  trim_http_whitespace(input);
+
+  // Every search below steps through the bitmasks of the scanner instead of
+  // rescanning the input.
+  scanner_type scanner(input);
+
+  raw_mime_type_essence essence{};
+  if (!parse_mime_type_essence(input, scanner, essence)) {
+    return false;
+  }
+
+  // Let mimeType be a new MIME type record whose type is type, in ASCII
+  // lowercase, and subtype is subtype, in ASCII lowercase.
+  h.on_essence(essence.type, essence.type_map, essence.subtype,
+               essence.subtype_map);
+
+  size_t position = essence.end;
+  raw_mime_type_parameter parameter{};
+  size_t parameter_count = 0;
+  while (next_mime_type_parameter(input, scanner, position, parameter)) {
+    if (++parameter_count > max_parameters) {
+      return false;
+    }
+    h.on_parameter(parameter.name, parameter.name_map, parameter.value,
+                   parameter.escaped);
+  }
+
+  return true;
+}
+
+}  // namespace ada::mimesniff
+
+#endif  // ADA_MIMESNIFF_PARSER_INL_H
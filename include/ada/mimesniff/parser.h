@@ -1,9 +1,15 @@
 #ifndef ADA_MIMESNIFF_PARSER_H
 #define ADA_MIMESNIFF_PARSER_H
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
 #include <string_view>
 #include <optional>
 
+#include "ada/mimesniff/lazy_mimetype.h"
 #include "ada/mimesniff/mimetype.h"
+#include "ada/mimesniff/mimetype_view.h"
+#include "ada/mimesniff/parameter_name_set.h"
 
 namespace ada::mimesniff {
 
@@ -11,5 +17,117 @@ namespace ada::mimesniff {
 // It is expected to be UTF-8 encoded, which includes ASCII.
 std::optional<mimetype> parse_mime_type(std::string_view input);
 
+/**
+ * Limits on the inputs to parse, so that a hostile header fails fast instead
+ * of being parsed in full. Both default to no limit.
+ */
+struct parse_options {
+  // Inputs longer than this fail before anything is parsed.
+  size_t max_length{~size_t(0)};
+  // Inputs with more parameters than this fail as soon as one too many is
+  // found. Every parameter with a valid name counts, kept or not.
+  size_t max_parameters{~size_t(0)};
+};
+
+/**
+ * Parses the input like `parse_mime_type`, or fails if it goes over one of
+ * the limits.
+ */
+std::optional<mimetype> parse_mime_type(std::string_view input,
+                                        const parse_options& options);
+
+/**
+ * Parses the input like `parse_mime_type`, allocating the result from the
+ * given memory resource instead of the global heap. Parsing itself does not
+ * allocate anything else: past parameter_name_set::linear_threshold
+ * parameters, the names checked for duplicates also go to the resource.
+ */
+std::optional<pmr::mimetype> parse_mime_type(
+    std::string_view input, std::pmr::memory_resource* resource);
+
+/**
+ * Parses the input into an existing record, reusing the capacity of its
+ * buffer. Once the buffer is large enough, parsing does not allocate, unless
+ * the input has more than parameter_name_set::linear_threshold parameters:
+ * their names are then checked for duplicates in a table allocated by the
+ * call, from the resource of a `pmr::mimetype`. A `parser` keeps that table
+ * between calls. Returns false on failure, in which case the record is left
+ * empty.
+ */
+bool parse_mime_type_into(mimetype& out, std::string_view input);
+bool parse_mime_type_into(pmr::mimetype& out, std::string_view input);
+
+/**
+ * Parses `count` inputs into the caller's records, like parse_mime_type_into,
+ * so that parsing a large batch of stored values does not allocate once the
+ * records have grown. The table of names that inputs with more than
+ * parameter_name_set::linear_threshold parameters need is shared by the
+ * batch. Bit i of `valid`, i.e., `valid[i / 64] >> (i % 64) & 1`, is set when
+ * inputs[i] is a valid MIME type. `valid` must hold `(count + 63) / 64`
+ * words. Returns the number of valid inputs.
+ *
+ * The inputs are processed in small groups: the bytes and records of the next
+ * group are prefetched while the current one is parsed, and the validity bits
+ * are written without branching.
+ */
+size_t parse_mime_types(const std::string_view* inputs, size_t count,
+                        mimetype* results, uint64_t* valid);
+
+struct validation_result {
+  // Whether the input is a valid MIME type.
+  bool valid{false};
+  // Whether the input is byte for byte its own serialization, in which case
+  // it can be forwarded as is.
+  bool canonical{false};
+};
+
+/**
+ * Tells whether `parse_mime_type(input)` would succeed and whether
+ * `parse_mime_type(input)->serialized() == input`, without allocating unless
+ * the input has more than parameter_name_set::linear_threshold parameters.
+ */
+validation_result validate_mime_type(std::string_view input);
+
+/**
+ * Parses MIME types into a record it owns and keeps between calls, so a loop
+ * over many inputs reaches a steady state without any allocation. A parser is
+ * not thread-safe: use one per thread, e.g. `parser::thread_local_instance()`.
+ */
+class parser {
+ public:
+  parser() = default;
+  parser(const parser&) = delete;
+  parser& operator=(const parser&) = delete;
+
+  /**
+   * Returns the parsed MIME type, or nullptr on failure. The result is owned
+   * by the parser and is only valid until the next call.
+   */
+  const mimetype* parse(std::string_view input);
+
+  // Returns the parser of the calling thread.
+  static parser& thread_local_instance();
+
+ private:
+  mimetype result_{};
+  // The names checked for duplicates, whose table is kept as well.
+  parameter_name_set names_{};
+};
+
+/**
+ * Parses the input like `parse_mime_type` but returns views into the input
+ * instead of copies. The input must outlive the result. Only the components
+ * that are not already in ASCII lowercase or that contain escapes are copied.
+ */
+std::optional<mimetype_view> parse_mime_type_view(std::string_view input);
+
+/**
+ * Validates the type and subtype of the input and leaves its parameters
+ * unparsed: they are parsed, following the same rules as `parse_mime_type`,
+ * while iterating over them or looking one up. The input must outlive the
+ * result. Returns std::nullopt if `parse_mime_type` would fail.
+ */
+std::optional<lazy_mimetype> parse_mime_type_lazy(std::string_view input);
+
 }  // namespace ada::mimesniff
 #endif
@@ -0,0 +1,38 @@
+#ifndef ADA_MIMESNIFF_PORTABILITY_H
+#define ADA_MIMESNIFF_PORTABILITY_H
+
+#if defined(__x86_64__) || defined(_M_AMD64)
+#define ADA_MIMESNIFF_IS_X86_64 1
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define ADA_MIMESNIFF_IS_ARM64 1
+#endif
+
+#if defined(__BYTE_ORDER__) && defined(__ORDER_BIG_ENDIAN__) && \
+    __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define ADA_MIMESNIFF_IS_BIG_ENDIAN 1
+#else
+#define ADA_MIMESNIFF_IS_BIG_ENDIAN 0
+#endif
+
+#define ADA_MIMESNIFF_STRINGIFY_IMPLEMENTATION_(a) #a
+#define ADA_MIMESNIFF_STRINGIFY(a) ADA_MIMESNIFF_STRINGIFY_IMPLEMENTATION_(a)
+
+// Everything between ADA_MIMESNIFF_TARGET_REGION("avx2") and
+// ADA_MIMESNIFF_UNTARGET_REGION is compiled for that instruction set, whatever
+// the flags of the build. It must only run after checking that the processor
+// supports it. Visual Studio needs no attribute to use the intrinsics.
+#if defined(__clang__)
+#define ADA_MIMESNIFF_TARGET_REGION(T)                                       \
+  _Pragma(ADA_MIMESNIFF_STRINGIFY(clang attribute push(                      \
+      __attribute__((target(T))), apply_to = function)))
+#define ADA_MIMESNIFF_UNTARGET_REGION _Pragma("clang attribute pop")
+#elif defined(__GNUC__)
+#define ADA_MIMESNIFF_TARGET_REGION(T) \
+  _Pragma("GCC push_options") _Pragma(ADA_MIMESNIFF_STRINGIFY(GCC target(T)))
+#define ADA_MIMESNIFF_UNTARGET_REGION _Pragma("GCC pop_options")
+#else
+#define ADA_MIMESNIFF_TARGET_REGION(T)
+#define ADA_MIMESNIFF_UNTARGET_REGION
+#endif
+
+#endif  // ADA_MIMESNIFF_PORTABILITY_H
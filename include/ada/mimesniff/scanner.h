@@ -0,0 +1,177 @@
+#ifndef ADA_MIMESNIFF_SCANNER_H
+#define ADA_MIMESNIFF_SCANNER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#include "ada/mimesniff/implementation.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace ada::mimesniff {
+
+// The classes of bytes the MIME type parser stops at. They can be combined.
+struct structural {
+  static constexpr uint8_t slash = 1;       // U+002F (/)
+  static constexpr uint8_t semicolon = 2;   // U+003B (;)
+  static constexpr uint8_t equals = 4;      // U+003D (=)
+  static constexpr uint8_t quote = 8;       // U+0022 (")
+  static constexpr uint8_t backslash = 16;  // U+005C (\)
+  static constexpr uint8_t whitespace = 32; // HTTP whitespace
+};
+
+// One bit per byte of a block, for each class of structural bytes. Bit i
+// corresponds to the i-th byte of the block. Blocks are at most 64 bytes.
+struct structural_masks {
+  uint64_t slash{};
+  uint64_t semicolon{};
+  uint64_t equals{};
+  uint64_t quote{};
+  uint64_t backslash{};
+  uint64_t whitespace{};
+
+  constexpr uint64_t select(uint8_t classes) const noexcept {
+    uint64_t mask = 0;
+    if (classes & structural::slash) mask |= slash;
+    if (classes & structural::semicolon) mask |= semicolon;
+    if (classes & structural::equals) mask |= equals;
+    if (classes & structural::quote) mask |= quote;
+    if (classes & structural::backslash) mask |= backslash;
+    if (classes & structural::whitespace) mask |= whitespace;
+    return mask;
+  }
+};
+
+inline int trailing_zeroes(uint64_t mask) noexcept {
+#if defined(_MSC_VER) && !defined(__clang__)
+  unsigned long index;
+  _BitScanForward64(&index, mask);
+  return int(index);
+#else
+  return __builtin_ctzll(mask);
+#endif
+}
+
+/**
+ * Finds structural bytes in the input with the bitmasks computed by the
+ * active implementation, following the idea of simdjson's stage 1. Blocks are
+ * classified lazily, once, so stepping from one structural byte to the next
+ * never rescans the input. Most MIME types fit in one or two blocks, which is
+ * why blocks are kept as narrow as a vector register.
+ */
+class structural_scanner {
+ public:
+  explicit structural_scanner(std::string_view input) noexcept
+      : structural_scanner(input, get_active_implementation()) {}
+
+  structural_scanner(std::string_view input,
+                     const implementation* impl) noexcept
+      : input_(input),
+        implementation_(impl),
+        block_size_(impl->structural_block_size()),
+        block_mask_(block_size_ == 64 ? ~uint64_t(0)
+                                      : (uint64_t(1) << block_size_) - 1) {}
+
+  // Returns the position of the first byte at or after `from` that belongs to
+  // one of the classes, or the size of the input if there is none.
+  size_t find(uint8_t classes, size_t from) noexcept {
+    return next(classes, from, 0);
+  }
+
+  // Returns the position of the first byte at or after `from` that belongs to
+  // none of the classes, or the size of the input if there is none.
+  size_t find_not(uint8_t classes, size_t from) noexcept {
+    return next(classes, from, ~uint64_t(0));
+  }
+
+ private:
+  size_t next(uint8_t classes, size_t from, uint64_t flip) noexcept {
+    while (from < input_.size()) {
+      // Block sizes are powers of two.
+      size_t block_start = from & ~(block_size_ - 1);
+      if (block_start != block_start_) {
+        load(block_start);
+      }
+      uint64_t mask = ((masks_.select(classes) ^ flip) & block_mask_) >>
+                      (from - block_start);
+      if (mask != 0) {
+        size_t position = from + trailing_zeroes(mask);
+        return position < input_.size() ? position : input_.size();
+      }
+      from = block_start + block_size_;
+    }
+    return input_.size();
+  }
+
+  void load(size_t block_start) noexcept {
+    block_start_ = block_start;
+    size_t length = input_.size() - block_start;
+    implementation_->classify_structural_block(
+        input_.data() + block_start,
+        length < block_size_ ? length : block_size_, masks_);
+  }
+
+  std::string_view input_;
+  const implementation* implementation_;
+  size_t block_size_;
+  uint64_t block_mask_;
+  size_t block_start_{~size_t(0)};
+  structural_masks masks_{};
+};
+
+/**
+ * The same interface as structural_scanner, looking at one byte at a time. It
+ * is usable in constant expressions, where the kernels of the implementations
+ * cannot run.
+ */
+class scalar_structural_scanner {
+ public:
+  constexpr explicit scalar_structural_scanner(std::string_view input) noexcept
+      : input_(input) {}
+
+  constexpr size_t find(uint8_t classes, size_t from) const noexcept {
+    while (from < input_.size() && !(classify(input_[from]) & classes)) {
+      from++;
+    }
+    return from < input_.size() ? from : input_.size();
+  }
+
+  constexpr size_t find_not(uint8_t classes, size_t from) const noexcept {
+    while (from < input_.size() && (classify(input_[from]) & classes)) {
+      from++;
+    }
+    return from < input_.size() ? from : input_.size();
+  }
+
+ private:
+  static constexpr uint8_t classify(char c) noexcept {
+    switch (c) {
+      case '/':
+        return structural::slash;
+      case ';':
+        return structural::semicolon;
+      case '=':
+        return structural::equals;
+      case '"':
+        return structural::quote;
+      case '\\':
+        return structural::backslash;
+      case ' ':
+      case '\t':
+      case '\r':
+      case '\n':
+        return structural::whitespace;
+      default:
+        return 0;
+    }
+  }
+
+  std::string_view input_;
+};
+
+}  // namespace ada::mimesniff
+
+#endif  // ADA_MIMESNIFF_SCANNER_H
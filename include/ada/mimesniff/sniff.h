@@ -0,0 +1,188 @@
+#ifndef ADA_MIMESNIFF_SNIFF_H
+#define ADA_MIMESNIFF_SNIFF_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#include "ada/mimesniff/essence.h"
+
+namespace ada::mimesniff {
+
+// The number of bytes of a resource that sniffing looks at.
+// https://mimesniff.spec.whatwg.org/#reading-the-resource-header
+constexpr inline size_t resource_header_size = 1445;
+
+/**
+ * Runs the rules for identifying an unknown MIME type on the resource header
+ * and returns the essence it computes, never essence_id::unknown: the bytes
+ * after the first resource_header_size ones are ignored. The essence is the
+ * one a parsed MIME type reports, so `parse_mime_type(to_string(id))` gives
+ * the full record when it is needed.
+ * https://mimesniff.spec.whatwg.org/#rules-for-identifying-an-unknown-mime-type
+ *
+ * When `sniff_scriptable` is true, the header is first checked for HTML, XML
+ * and PDF, which a browser may only do when the resource is not served with
+ * "X-Content-Type-Options: nosniff".
+ *
+ * The signatures of the standard are compiled into tables grouped by first
+ * byte, so a header is compared to a handful of patterns, each with a single
+ * masked 16-byte compare.
+ */
+essence_id identify_unknown_mime_type(std::string_view resource_header,
+                                      bool sniff_scriptable);
+
+/**
+ * Returns true if the resource header, after its leading whitespace, starts
+ * with one of the HTML signatures of the rules for identifying an unknown
+ * MIME type, such as "<!DOCTYPE HTML" or "<SCRIPT" in any ASCII case,
+ * followed by a space or ">". Only scriptable sniffing looks for them.
+ *
+ * The signatures are not tried one after the other: the first space or ">"
+ * of the header and the case-folded bytes before it name the only one that
+ * may match, which a single masked 16-byte compare checks.
+ */
+bool matches_html_signature(std::string_view resource_header) noexcept;
+
+/**
+ * Runs the image type pattern matching algorithm: returns the image type the
+ * resource header starts with, among BMP, GIF, ICO, JPEG, PNG and WebP, or
+ * essence_id::unknown. It is how a server checks that bytes declared with an
+ * image type really are an image it can handle:
+ *
+ *   if (match_image_type_pattern(body) != essence_id::image_png) reject();
+ *
+ * The header is only read in place. Each signature is a single masked 16-byte
+ * compare, and only the signatures sharing the first byte of the header are
+ * tried: at most two.
+ * https://mimesniff.spec.whatwg.org/#matching-an-image-type-pattern
+ */
+essence_id match_image_type_pattern(std::string_view resource_header) noexcept;
+
+/**
+ * Runs the audio or video type pattern matching algorithm: returns the audio
+ * or video type the resource header starts with, or essence_id::unknown.
+ * Besides the signatures, it walks the `ftyp` box of MP4, the EBML header of
+ * WebM and the first two frame headers of an MP3 without an ID3 tag.
+ *
+ * Only the first resource_header_size bytes are looked at, each of them at
+ * most once, so the cost of a hostile header is bounded by that of any other.
+ * Nothing is allocated.
+ * https://mimesniff.spec.whatwg.org/#matching-an-audio-or-video-type-pattern
+ */
+essence_id match_audio_or_video_type_pattern(
+    std::string_view resource_header) noexcept;
+
+/**
+ * Returns true if the resource header contains a binary data byte, which a
+ * text resource does not.
+ * https://mimesniff.spec.whatwg.org/#binary-data-byte
+ */
+bool contains_binary_data_bytes(std::string_view resource_header) noexcept;
+
+// Where a streaming_sniffer stands.
+enum class sniff_status : uint8_t {
+  // A signature may still match: more bytes are needed.
+  need_more_bytes,
+  // The result is known and will not change.
+  decided,
+  // No signature can match. The result is text/plain unless a binary data
+  // byte follows, which only the rest of the resource header can tell: the
+  // sniffer decides application/octet-stream on the first one, or text/plain
+  // at the end of the resource header or of the resource.
+  undecidable,
+};
+
+/**
+ * Runs the rules for identifying an unknown MIME type on a resource that
+ * arrives in chunks, as `identify_unknown_mime_type` would on its resource
+ * header, and decides as soon as the bytes seen so far settle the result.
+ * For most resources, it is the first chunk:
+ *
+ *   streaming_sniffer sniffer(false);
+ *   for (std::string_view chunk : body) {
+ *     if (sniffer.feed(chunk) == sniff_status::decided) break;
+ *   }
+ *   essence_id type = sniffer.finish();
+ *
+ * The chunks are not kept nor concatenated. The sniffer copies the first
+ * bytes of the resource and the bytes right after any leading whitespace,
+ * and reads the rest as it goes by, for the MP4 brands, the second MP3 frame
+ * header, the WebM DocType padding and binary data bytes. It never allocates
+ * and is a few hundred bytes large.
+ */
+class streaming_sniffer {
+ public:
+  explicit streaming_sniffer(bool sniff_scriptable) noexcept
+      : sniff_scriptable_(sniff_scriptable) {}
+
+  /**
+   * Reads the next bytes of the resource and returns the new status. The
+   * chunk can be of any size, and is not referenced after the call. Bytes
+   * past the resource header, or past a decision, are ignored.
+   */
+  sniff_status feed(std::string_view chunk) noexcept;
+
+  /**
+   * Signals the end of the resource, which decides the result, and returns
+   * it.
+   */
+  essence_id finish() noexcept;
+
+  sniff_status status() const noexcept { return status_; }
+
+  // The essence once decided, essence_id::unknown before.
+  essence_id result() const noexcept { return result_; }
+
+  /**
+   * The fewest bytes to feed before the status is certain to change: 0 once
+   * decided. Waiting for that many before feeding again loses nothing,
+   * although fewer may do when they rule out what the sniffer is waiting
+   * for. When undecidable, it is the rest of the resource header.
+   */
+  size_t bytes_needed() const noexcept { return bytes_needed_; }
+
+  // The number of bytes of the resource header read so far.
+  size_t bytes_seen() const noexcept { return length_; }
+
+ private:
+  static constexpr size_t stash_size = 64;
+
+  // Updates the status with the bytes read so far, of which `unscanned`
+  // were not looked at for binary data bytes yet.
+  sniff_status evaluate(std::string_view unscanned) noexcept;
+  // Returns decided or need_more_bytes if a signature matches or may match,
+  // and undecidable otherwise.
+  sniff_status match_signatures() noexcept;
+  sniff_status decide(essence_id id) noexcept;
+  sniff_status wait(size_t bytes) noexcept;
+
+  bool sniff_scriptable_;
+  bool complete_{false};
+  sniff_status status_{sniff_status::need_more_bytes};
+  essence_id result_{essence_id::unknown};
+  size_t bytes_needed_{1};
+  size_t length_{0};
+  // The first bytes of the resource, padded with zeroes.
+  uint8_t stash_[stash_size]{};
+  // The leading whitespace, and the 16 bytes after it, padded with zeroes.
+  size_t whitespace_{0};
+  bool in_whitespace_{true};
+  uint8_t after_whitespace_[16]{};
+  bool binary_{false};
+  // The MP4 brands past the major one, read a word at a time.
+  uint32_t mp4_word_{0};
+  bool mp4_brand_{false};
+  // The header of the second MP3 frame.
+  uint8_t mp3_next_[4]{};
+  // Once the stash is full, where the WebM check stands. It can then only
+  // wait for a DocType at the end of its padding, of which webm_matched_
+  // bytes are seen.
+  enum class webm_check : uint8_t { no, yes, pending };
+  webm_check webm_{webm_check::no};
+  uint8_t webm_matched_{0};
+};
+
+}  // namespace ada::mimesniff
+
+#endif  // ADA_MIMESNIFF_SNIFF_H
@@ -0,0 +1,268 @@
+#ifndef ADA_MIMESNIFF_STATIC_MIMETYPE_H
+#define ADA_MIMESNIFF_STATIC_MIMETYPE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "ada/mimesniff/essence.h"
+#include "ada/mimesniff/mimetype.h"
+#include "ada/mimesniff/parameter_name.h"
+#include "ada/mimesniff/parser-inl.h"
+#include "ada/mimesniff/scanner.h"
+#include "ada/mimesniff/util-inl.h"
+#include "ada/mimesniff/util.h"
+
+namespace ada::mimesniff {
+
+/**
+ * A MIME type record stored in a fixed-capacity array, with the same layout
+ * as the buffer of `mimetype`: the essence followed by "\0name\0value" for
+ * each parameter. It is a literal type, so MIME types known in advance can be
+ * parsed, validated and canonicalized at compile time:
+ *
+ *   constexpr auto html = parse_static_mime_type("Text/HTML;Charset=UTF-8");
+ *
+ * Parsing fails when the canonical bytes do not fit in `capacity`.
+ */
+template <size_t capacity = 128>
+class static_mimetype {
+ public:
+  using parameter = packed_parameter_iterator::value_type;
+  using parameter_iterator = packed_parameter_iterator;
+  using parameter_list = packed_parameter_list;
+
+  constexpr static_mimetype() = default;
+
+  constexpr std::string_view type() const noexcept {
+    return {data_, type_length_};
+  }
+
+  constexpr std::string_view subtype() const noexcept {
+    return {data_ + type_length_ + 1, essence_length_ - type_length_ - 1};
+  }
+
+  constexpr std::string_view essence() const noexcept {
+    return {data_, essence_length_};
+  }
+
+  // The id of the essence, or essence_id::unknown if it is not a well-known
+  // one.
+  constexpr essence_id id() const noexcept { return essence_id_; }
+
+  constexpr parameter_list parameters() const noexcept {
+    return {std::string_view(data_ + essence_length_, size_ - essence_length_),
+            parameter_count_};
+  }
+
+  // Returns the value of the parameter with the given (lowercase) name.
+  constexpr std::optional<std::string_view> get_parameter(
+      std::string_view name) const noexcept {
+    for (const parameter &p : parameters()) {
+      if (p.first == name) {
+        return p.second;
+      }
+    }
+    return std::nullopt;
+  }
+
+  // Returns the value of the parameter with a common name.
+  constexpr std::optional<std::string_view> get_parameter(
+      parameter_name_id id) const noexcept {
+    return get_parameter(to_string(id));
+  }
+
+  /**
+   * @see https://mimesniff.spec.whatwg.org/#serializing-a-mime-type
+   */
+  std::string serialized() const noexcept {
+    return serialize_mime_type(type(), subtype(), parameters());
+  }
+
+  // The exact size of serialized().
+  constexpr size_t serialized_size() const noexcept {
+    return serialized_mime_type_size(type(), subtype(), parameters());
+  }
+
+  /**
+   * Writes the serialization to output if it fits in `output_capacity` bytes
+   * and returns its size. Nothing is written when it does not fit.
+   */
+  constexpr size_t serialize_to(char *output,
+                                size_t output_capacity) const noexcept {
+    return serialize_mime_type_to(output, output_capacity, type(), subtype(),
+                                  parameters());
+  }
+
+  // Appends the serialization to output, growing it at most once.
+  void serialize_to(std::string &output) const {
+    append_serialized_mime_type(output, type(), subtype(), parameters());
+  }
+
+  // Returns an equivalent record that can be modified.
+  mimetype to_mimetype() const {
+    mimetype out(type(), subtype());
+    for (const parameter &p : parameters()) {
+      out.set_parameter(p.first, p.second);
+    }
+    return out;
+  }
+
+ private:
+  template <size_t>
+  friend struct static_mimetype_builder;
+
+  char data_[capacity]{};
+  size_t size_{0};
+  size_t type_length_{0};
+  size_t essence_length_{0};
+  size_t parameter_count_{0};
+  essence_id essence_id_{essence_id::unknown};
+};
+
+template <size_t capacity>
+struct static_mimetype_builder {
+  static_mimetype<capacity> &out;
+  bool overflow{false};
+
+  // Appends the bytes if they fit, otherwise the parse fails.
+  constexpr char *append(std::string_view bytes) noexcept {
+    if (bytes.size() > capacity - out.size_) {
+      overflow = true;
+      return nullptr;
+    }
+    char *position = out.data_ + out.size_;
+    for (size_t i = 0; i < bytes.size(); i++) {
+      position[i] = bytes[i];
+    }
+    out.size_ += bytes.size();
+    return position;
+  }
+
+  constexpr void on_essence(std::string_view type, uint8_t type_map,
+                            std::string_view subtype,
+                            uint8_t subtype_map) noexcept {
+    char *lowered_type = append(type);
+    append("/");
+    char *lowered_subtype = append(subtype);
+    if (overflow) {
+      return;
+    }
+    if (type_map & 4) {
+      to_lower_ascii(lowered_type, type.size());
+    }
+    if (subtype_map & 4) {
+      to_lower_ascii(lowered_subtype, subtype.size());
+    }
+    out.type_length_ = type.size();
+    out.essence_length_ = out.size_;
+    out.essence_id_ = lookup_essence(out.type(), out.subtype());
+  }
+
+  constexpr void on_parameter(std::string_view name, uint8_t name_map,
+                              std::string_view value, bool escaped) noexcept {
+    if (overflow) {
+      return;
+    }
+    // If all of the following are true
+    // - parameterValue solely contains HTTP quoted-string token code points
+    // - mimeType’s parameters[parameterName] does not exist
+    // They are checked on the input, so that a parameter that is dropped is
+    // never copied and cannot make the record overflow.
+    bool valid = escaped
+                     ? escaped_contains_only_http_quoted_string_tokens(value)
+                     : contains_only_http_quoted_string_tokens(value);
+    if (!valid || has_parameter(name)) {
+      return;
+    }
+    // then set mimeType’s parameters[parameterName] to parameterValue.
+    append(std::string_view("\0", 1));
+    // A common name is packed as its id, which needs no lowercasing.
+    parameter_name_id id = lookup_parameter_name(name);
+    const char code[1] = {char(id)};
+    char *lowered_name = id != parameter_name_id::unknown
+                             ? append(std::string_view(code, 1))
+                             : append(name);
+    append(std::string_view("\0", 1));
+    char *copied_value = append(value);
+    if (overflow) {
+      return;
+    }
+    if (id == parameter_name_id::unknown && (name_map & 4)) {
+      to_lower_ascii(lowered_name, name.size());
+    }
+    if (escaped) {
+      out.size_ = size_t(copied_value - out.data_) +
+                  unescape_http_quoted_string(value, copied_value);
+    }
+    out.parameter_count_++;
+  }
+
+  // Returns true if a stored parameter has that name, ignoring ASCII case.
+  constexpr bool has_parameter(std::string_view name) const noexcept {
+    for (const auto &p : out.parameters()) {
+      if (equals_ignoring_ascii_case(name, p.first)) {
+        return true;
+      }
+    }
+    return false;
+  }
+};
+
+/**
+ * Parses the input into a fixed-capacity record, in a constant expression if
+ * need be. Returns false on failure or when the record is too small, in which
+ * case its content is unspecified.
+ */
+template <size_t capacity>
+constexpr bool parse_mime_type_into(static_mimetype<capacity> &out,
+                                    std::string_view input) noexcept {
+  out = static_mimetype<capacity>{};
+  static_mimetype_builder<capacity> builder{out};
+  return parse_mime_type_components<scalar_structural_scanner>(input,
+                                                               builder) &&
+         !builder.overflow;
+}
+
+template <size_t capacity = 128>
+constexpr std::optional<static_mimetype<capacity>> parse_static_mime_type(
+    std::string_view input) noexcept {
+  static_mimetype<capacity> out{};
+  if (!parse_mime_type_into(out, input)) {
+    return std::nullopt;
+  }
+  return out;
+}
+
+// Not constexpr on purpose: reaching it while evaluating a constant
+// expression makes the expression ill-formed, hence a build error.
+inline void invalid_mime_type_literal() noexcept { std::abort(); }
+
+namespace literals {
+
+/**
+ * Parses a MIME type literal. Used to initialize a constexpr variable, it is
+ * parsed at compile time and a malformed literal fails the build:
+ *
+ *   using namespace ada::mimesniff::literals;
+ *   constexpr auto json = "application/json; charset=utf-8"_mime;
+ *
+ * Evaluated at runtime, a malformed literal aborts.
+ */
+constexpr static_mimetype<> operator""_mime(const char *input,
+                                            size_t length) noexcept {
+  static_mimetype<> out{};
+  if (!parse_mime_type_into(out, std::string_view(input, length))) {
+    invalid_mime_type_literal();
+  }
+  return out;
+}
+
+}  // namespace literals
+
+}  // namespace ada::mimesniff
+
+#endif  // ADA_MIMESNIFF_STATIC_MIMETYPE_H
@@ -1,10 +1,12 @@
 #ifndef ADA_MIMESNIFF_UTIL_INL_H
 #define ADA_MIMESNIFF_UTIL_INL_H
 
+#include <algorithm>
 #include <cstring>
 #include <string>
 #include <string_view>
 
+#include "ada/mimesniff/scanner.h"
 #include "ada/mimesniff/util.h"
 
 namespace ada::mimesniff {
@@ -50,16 +52,70 @@ constexpr static uint8_t http_tokens_map_table[256] = {
     128, 128, 128, 128, 128, 128, 128, 128, 128, 128, 128, 128, 128, 128, 128,
     128};
 
+constexpr inline bool is_constant_evaluated() noexcept {
+#if defined(__GNUC__) || defined(__clang__) || \
+    (defined(_MSC_VER) && _MSC_VER >= 1925)
+  return __builtin_is_constant_evaluated();
+#else
+  // Without the builtin, the portable code is used everywhere.
+  return true;
+#endif
+}
+
+// For each class of http_tokens_map_table, one table indexed by the low nibble
+// of a byte whose bit h is set when the byte with high nibble h belongs to the
+// class. A byte is in the class iff lookup(low) & (1 << high) is non-zero,
+// which is two byte shuffles and an and per vector.
+struct token_nibble_tables {
+  uint8_t lower[16]{};   // ASCII lowercase letters and digits (1)
+  uint8_t symbol[16]{};  // the other HTTP token code points (2)
+  uint8_t upper[16]{};   // ASCII uppercase letters (4)
+  // Maps a high nibble to its bit. Bytes outside ASCII map to zero and thus
+  // to no class at all.
+  uint8_t high[16]{1, 2, 4, 8, 16, 32, 64, 128};
+};
+
+constexpr inline token_nibble_tables make_token_nibble_tables() {
+  token_nibble_tables t{};
+  for (int c = 0; c < 128; c++) {
+    uint8_t bit = uint8_t(1 << (c >> 4));
+    switch (http_tokens_map_table[c]) {
+      case 1:
+        t.lower[c & 0xF] |= bit;
+        break;
+      case 2:
+        t.symbol[c & 0xF] |= bit;
+        break;
+      case 4:
+        t.upper[c & 0xF] |= bit;
+        break;
+      default:
+        break;
+    }
+  }
+  return t;
+}
+
+inline constexpr token_nibble_tables token_nibble_lookup =
+    make_token_nibble_tables();
+
+constexpr inline uint8_t http_tokens_map_scalar(std::string_view view) {
+  uint8_t token = 0;
+  for (const char c : view) {
+    token |= http_tokens_map_table[uint8_t(c)];
+  }
+  return token;
+}
+
 constexpr inline uint8_t http_tokens_map(std::string_view view) {
   // An HTTP token code point is U+0021 (!), U+0023 (#), U+0024 ($),
   // U+0025 (%), U+0026 (&), U+0027 ('), U+002A (*), U+002B (+), U+002D (-),
   // U+002E (.), U+005E (^), U+005F (_), U+0060 (`), U+007C (|), U+007E (~), or
   // an ASCII alphanumeric.
-  uint8_t token = 0;
-  for (const char c : view) {
-    token |= http_tokens_map_table[uint8_t(c)];
+  if (!is_constant_evaluated() && view.size() >= vectorized_kernel_size) {
+    return http_tokens_map_vectorized(view);
   }
-  return token;
+  return http_tokens_map_scalar(view);
 }
 constexpr inline bool contains_only_http_tokens(std::string_view view) {
   // An HTTP token code point is U+0021 (!), U+0023 (#), U+0024 ($),
@@ -69,7 +125,7 @@ constexpr inline bool contains_only_http_tokens(std::string_view view) {
   return !(http_tokens_map(view) & 128);
 }
 
-constexpr inline bool contains_only_http_quoted_string_tokens(
+constexpr inline bool contains_only_http_quoted_string_tokens_scalar(
     std::string_view view) {
   for (size_t i = 0; i < view.size(); i++) {
     const uint8_t c(view[i]);
@@ -95,53 +151,133 @@ constexpr inline bool contains_only_http_quoted_string_tokens(
   return true;
 }
 
-inline std::string collect_http_quoted_string(std::string_view& input) {
-  // It is the callers responsability that the string passed starts with ".
-  std::string value{};
+constexpr inline bool contains_only_http_quoted_string_tokens(
+    std::string_view view) {
+  if (!is_constant_evaluated() && view.size() >= vectorized_kernel_size) {
+    return contains_only_http_quoted_string_tokens_vectorized(view);
+  }
+  return contains_only_http_quoted_string_tokens_scalar(view);
+}
 
-  input.remove_prefix(1);
+constexpr inline bool escaped_contains_only_http_quoted_string_tokens(
+    std::string_view raw) {
+  // Same rules as contains_only_http_quoted_string_tokens_scalar, one
+  // unescaped byte at a time: a byte from 0xC2 or 0xC3 must be followed by
+  // 0x80 to 0xBF.
+  bool expect_continuation = false;
+  for (size_t i = 0; i < raw.size(); i++) {
+    if (raw[i] == '\\' && i + 1 < raw.size()) {
+      i++;
+    }
+    const uint8_t c(raw[i]);
+    if (expect_continuation) {
+      if (c < 0x80 || c > 0xBF) {
+        return false;
+      }
+      expect_continuation = false;
+    } else if (c == 0xC2 || c == 0xC3) {
+      expect_continuation = true;
+    } else if (c != '\t' && (c < ' ' || c > '~')) {
+      return false;
+    }
+  }
+  return !expect_continuation;
+}
 
-  while (true) {
-    // Append the result of collecting a sequence of code points that are not
-    // U+0022 (") or U+005C (\) from input, given position, to value.
-    auto end_index = input.find_first_of("\"\\");
-    // If position is past the end of input, then break.
-    if (end_index == std::string_view::npos) {
-      value.append(input);
-      break;
+constexpr inline bool equals_ignoring_ascii_case(
+    std::string_view view, std::string_view lowercase) noexcept {
+  if (view.size() != lowercase.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < view.size(); i++) {
+    char c = view[i];
+    if (c >= 'A' && c <= 'Z') {
+      c = char(c | 0x20);
+    }
+    if (c != lowercase[i]) {
+      return false;
     }
+  }
+  return true;
+}
 
-    value.append(input.substr(0, end_index));
-    input.remove_prefix(end_index);
+// Returns the byte in ASCII lowercase. Only the ASCII upper alphas change:
+// setting 0x20 on any byte would also map ^ to ~, or @ to `.
+constexpr inline char to_lower_ascii_byte(char c) noexcept {
+  return (c >= 'A' && c <= 'Z') ? char(c | 0x20) : c;
+}
 
-    // Let quoteOrBackslash be the code point at position within input.
-    auto quote_or_backslash = input[0];
+// Like equals_ignoring_ascii_case, when neither side is known to be in ASCII
+// lowercase.
+constexpr inline bool ascii_case_insensitive_equals(
+    std::string_view a, std::string_view b) noexcept {
+  if (a.size() != b.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < a.size(); i++) {
+    if (to_lower_ascii_byte(a[i]) != to_lower_ascii_byte(b[i])) {
+      return false;
+    }
+  }
+  return true;
+}
 
-    // Advance position by 1.
-    input.remove_prefix(1);
+inline std::string_view collect_http_quoted_string_view(
+    std::string_view& input, std::string& storage) {
+  // It is the callers responsability that the string passed starts with ".
+  input.remove_prefix(1);
 
-    // If quoteOrBackslash is U+005C (\), then:
-    if (quote_or_backslash == '\\') {
-      // If position is past the end of input, then append U+005C (\) to value
-      // and break.
-      if (input.empty()) {
-        value += "\\";
-        break;
-      }
+  // Collect a sequence of code points that are not U+0022 (") or U+005C (\)
+  // from input, given position. The scanner of the active implementation
+  // classifies a whole block of the input at a time.
+  structural_scanner scanner(input);
+  constexpr uint8_t quote_or_backslash =
+      structural::quote | structural::backslash;
+  size_t end_index = scanner.find(quote_or_backslash, 0);
 
-      // Append the code point at position within input to value.
-      value += input[0];
+  // Without any U+005C (\), the value is the input up to the closing quote.
+  if (end_index == input.size() || input[end_index] == '"') {
+    std::string_view value = input.substr(0, end_index);
+    input.remove_prefix(std::min(end_index + 1, input.size()));
+    return value;
+  }
 
-      // Advance position by 1.
-      input.remove_prefix(1);
-    } else {
-      break;
-    }
+  // Otherwise, find the closing quote, skipping past each U+005C (\) and the
+  // code point it escapes, then unescape the whole value at once.
+  while (end_index < input.size() && input[end_index] == '\\') {
+    end_index = scanner.find(quote_or_backslash,
+                             std::min(end_index + 2, input.size()));
   }
+  std::string_view raw = input.substr(0, end_index);
+  storage.resize(raw.size());
+  storage.resize(unescape_http_quoted_string(raw, storage.data()));
+  input.remove_prefix(std::min(end_index + 1, input.size()));
+  return storage;
+}
 
+inline std::string collect_http_quoted_string(std::string_view& input) {
+  std::string value{};
+  std::string_view view = collect_http_quoted_string_view(input, value);
+  if (view.data() != value.data()) {
+    value.assign(view);
+  }
   return value;
 }
 
+constexpr inline size_t unescape_http_quoted_string(std::string_view raw,
+                                                   char* output) noexcept {
+  size_t length = 0;
+  for (size_t i = 0; i < raw.size(); i++) {
+    // A U+005C (\) at the very end of the input is kept as is, otherwise it is
+    // dropped and the code point that follows it is appended.
+    if (raw[i] == '\\' && i + 1 < raw.size()) {
+      i++;
+    }
+    output[length++] = raw[i];
+  }
+  return length;
+}
+
 constexpr void to_lower_ascii_short(char* input, size_t length) noexcept {
   for (size_t i = 0; i < length; i++) {
     char c = input[i] | 0x20;
@@ -152,7 +288,18 @@ constexpr void to_lower_ascii_short(char* input, size_t length) noexcept {
   return;
 }
 
-constexpr bool to_lower_ascii(char* input, size_t length) noexcept {
+constexpr bool to_lower_ascii_scalar(char* input, size_t length) noexcept {
+  if (is_constant_evaluated()) {
+    // memcpy cannot be used in a constant expression.
+    bool ascii = true;
+    for (size_t i = 0; i < length; i++) {
+      ascii = ascii && !(uint8_t(input[i]) & 0x80);
+      if (input[i] >= 'A' && input[i] <= 'Z') {
+        input[i] = char(input[i] | 0x20);
+      }
+    }
+    return ascii;
+  }
   auto broadcast = [](uint8_t v) -> uint64_t {
     return 0x101010101010101ull * v;
   };
@@ -181,5 +328,12 @@ constexpr bool to_lower_ascii(char* input, size_t length) noexcept {
   return non_ascii == 0;
 }
 
+constexpr bool to_lower_ascii(char* input, size_t length) noexcept {
+  if (!is_constant_evaluated() && length >= vectorized_kernel_size) {
+    return to_lower_ascii_vectorized(input, length);
+  }
+  return to_lower_ascii_scalar(input, length);
+}
+
 }  // namespace ada::mimesniff
 #endif
@@ -1,6 +1,8 @@
 #ifndef ADA_MIMESNIFF_UTIL_H
 #define ADA_MIMESNIFF_UTIL_H
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
 #include <string_view>
 
@@ -35,8 +37,45 @@ constexpr inline uint8_t http_tokens_map(std::string_view view);
 constexpr inline bool contains_only_http_quoted_string_tokens(
     std::string_view view);
 
+/**
+ * Same as contains_only_http_quoted_string_tokens for the content of an HTTP
+ * quoted string once unescaped, without unescaping it.
+ */
+constexpr inline bool escaped_contains_only_http_quoted_string_tokens(
+    std::string_view raw);
+
+/**
+ * Returns true if the view equals `lowercase`, which is in ASCII lowercase,
+ * ignoring ASCII case.
+ */
+constexpr inline bool equals_ignoring_ascii_case(
+    std::string_view view, std::string_view lowercase) noexcept;
+
+/**
+ * Collects an HTTP quoted string from input, which starts with U+0022 ("),
+ * and advances input past it. The result is the unescaped value.
+ * @see https://fetch.spec.whatwg.org/#collect-an-http-quoted-string
+ */
 inline std::string collect_http_quoted_string(std::string_view& input);
 
+/**
+ * Same as collect_http_quoted_string without copying the value when it has
+ * no U+005C (\) escapes, which is the common case: the result is then a view
+ * into input. Otherwise the value is unescaped into `storage` and the result
+ * is a view into it.
+ */
+inline std::string_view collect_http_quoted_string_view(
+    std::string_view& input, std::string& storage);
+
+/**
+ * Writes the unescaped content of an HTTP quoted string to output and returns
+ * the number of bytes written, which is at most raw.size(). The input is the
+ * content between the quotes, as it appears in the header.
+ * @see https://fetch.spec.whatwg.org/#collect-an-http-quoted-string
+ */
+constexpr inline size_t unescape_http_quoted_string(std::string_view raw,
+                                                   char* output) noexcept;
+
 /**
  * Lowers the string in-place, assuming that the content is ASCII.
  * Return true if the content was ASCII.
@@ -48,5 +87,30 @@ constexpr bool to_lower_ascii(char* input, size_t length) noexcept;
  * for short inputs (<= 8 characters).
  */
 constexpr void to_lower_ascii_short(char* input, size_t length) noexcept;
+
+/**
+ * The portable versions of http_tokens_map,
+ * contains_only_http_quoted_string_tokens and to_lower_ascii. They are used in
+ * constant expressions, for short inputs and by the scalar implementation.
+ */
+constexpr inline uint8_t http_tokens_map_scalar(std::string_view view);
+constexpr inline bool contains_only_http_quoted_string_tokens_scalar(
+    std::string_view view);
+constexpr bool to_lower_ascii_scalar(char* input, size_t length) noexcept;
+
+/**
+ * Inputs at least this long are handed to the active implementation.
+ * @see get_active_implementation
+ */
+constexpr size_t vectorized_kernel_size = 16;
+
+/**
+ * Run the kernels of the active implementation, which give the same results
+ * as the portable versions.
+ */
+uint8_t http_tokens_map_vectorized(std::string_view view) noexcept;
+bool contains_only_http_quoted_string_tokens_vectorized(
+    std::string_view view) noexcept;
+bool to_lower_ascii_vectorized(char* input, size_t length) noexcept;
 }  // namespace ada::mimesniff
 #endif
@@ -1,9 +1,25 @@
 #ifndef ADA_MIMESNIFF_H
 #define ADA_MIMESNIFF_H
 
+#include "ada/mimesniff/portability.h"
+#include "ada/mimesniff/implementation.h"
+#include "ada/mimesniff/essence.h"
+#include "ada/mimesniff/essence_matcher.h"
+#include "ada/mimesniff/parameter_name.h"
 #include "ada/mimesniff/mimetype.h"
+#include "ada/mimesniff/mimetype_view.h"
+#include "ada/mimesniff/parameter_name_set.h"
+#include "ada/mimesniff/lazy_mimetype.h"
 #include "ada/mimesniff/util-inl.h"
 #include "ada/mimesniff/util.h"
+#include "ada/mimesniff/scanner.h"
+#include "ada/mimesniff/parser-inl.h"
 #include "ada/mimesniff/parser.h"
+#include "ada/mimesniff/static_mimetype.h"
+#include "ada/mimesniff/parallel.h"
+#include "ada/mimesniff/cache.h"
+#include "ada/mimesniff/canonicalize.h"
+#include "ada/mimesniff/byte_pattern.h"
+#include "ada/mimesniff/sniff.h"
 
 #endif
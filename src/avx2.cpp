@@ -0,0 +1,180 @@
+#include "ada/mimesniff/portability.h"
+
+#if ADA_MIMESNIFF_IS_X86_64
+
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+#include <immintrin.h>
+
+#include "ada/mimesniff/implementation.h"
+#include "ada/mimesniff/scanner.h"
+#include "ada/mimesniff/util-inl.h"
+#include "ada/mimesniff/util.h"
+
+ADA_MIMESNIFF_TARGET_REGION("avx2")
+
+namespace ada::mimesniff::avx2 {
+
+namespace {
+
+inline __m256i broadcast_table(const uint8_t (&table)[16]) {
+  return _mm256_broadcastsi128_si256(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(table)));
+}
+
+inline uint64_t equal_mask(__m256i v, char c) {
+  return uint32_t(
+      _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(c))));
+}
+
+inline bool is_utf8_continuation(uint8_t c) { return (c & 0xC0) == 0x80; }
+
+}  // namespace
+
+class implementation final : public ada::mimesniff::implementation {
+ public:
+  constexpr implementation() noexcept
+      : ada::mimesniff::implementation("avx2", "Intel/AMD AVX2",
+                                       instruction_set::avx2, 32) {}
+
+  void classify_structural_block(
+      const char* block, size_t length,
+      structural_masks& masks) const noexcept override {
+    // The last block is padded with zeroes, which belong to no class.
+    char padded[32]{};
+    if (length < 32) {
+      std::memcpy(padded, block, length);
+      block = padded;
+    }
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block));
+    masks.slash = equal_mask(v, '/');
+    masks.semicolon = equal_mask(v, ';');
+    masks.equals = equal_mask(v, '=');
+    masks.quote = equal_mask(v, '"');
+    masks.backslash = equal_mask(v, '\\');
+    masks.whitespace = equal_mask(v, ' ') | equal_mask(v, '\t') |
+                       equal_mask(v, '\r') | equal_mask(v, '\n');
+  }
+
+  uint8_t http_tokens_map(std::string_view view) const noexcept override {
+    const __m256i lower_table = broadcast_table(token_nibble_lookup.lower);
+    const __m256i symbol_table = broadcast_table(token_nibble_lookup.symbol);
+    const __m256i upper_table = broadcast_table(token_nibble_lookup.upper);
+    const __m256i high_table = broadcast_table(token_nibble_lookup.high);
+    const __m256i nibble = _mm256_set1_epi8(0x0F);
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i any_lower = zero, any_symbol = zero, any_upper = zero,
+            any_other = zero;
+    size_t i = 0;
+    for (; i + 32 <= view.size(); i += 32) {
+      __m256i v = _mm256_loadu_si256(
+          reinterpret_cast<const __m256i*>(view.data() + i));
+      __m256i low = _mm256_and_si256(v, nibble);
+      __m256i high = _mm256_shuffle_epi8(
+          high_table, _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble));
+      __m256i lower =
+          _mm256_and_si256(_mm256_shuffle_epi8(lower_table, low), high);
+      __m256i symbol =
+          _mm256_and_si256(_mm256_shuffle_epi8(symbol_table, low), high);
+      __m256i upper =
+          _mm256_and_si256(_mm256_shuffle_epi8(upper_table, low), high);
+      any_lower = _mm256_or_si256(any_lower, lower);
+      any_symbol = _mm256_or_si256(any_symbol, symbol);
+      any_upper = _mm256_or_si256(any_upper, upper);
+      any_other = _mm256_or_si256(
+          any_other,
+          _mm256_cmpeq_epi8(
+              _mm256_or_si256(_mm256_or_si256(lower, symbol), upper), zero));
+    }
+    uint8_t token = http_tokens_map_scalar(view.substr(i));
+    token |= _mm256_testz_si256(any_lower, any_lower) ? 0 : 1;
+    token |= _mm256_testz_si256(any_symbol, any_symbol) ? 0 : 2;
+    token |= _mm256_testz_si256(any_upper, any_upper) ? 0 : 4;
+    token |= _mm256_testz_si256(any_other, any_other) ? 0 : 128;
+    return token;
+  }
+
+  bool contains_only_http_quoted_string_tokens(
+      std::string_view view) const noexcept override {
+    const __m256i tab = _mm256_set1_epi8('\t');
+    const __m256i below_space = _mm256_set1_epi8(0x1F);
+    const __m256i delete_char = _mm256_set1_epi8(0x7F);
+    const __m256i lead_c2 = _mm256_set1_epi8(char(0xC2));
+    const __m256i lead_c3 = _mm256_set1_epi8(char(0xC3));
+    const __m256i top_bits = _mm256_set1_epi8(char(0xC0));
+    const __m256i continuation = _mm256_set1_epi8(char(0x80));
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i previous_lead = zero;
+    __m256i error = zero;
+    size_t i = 0;
+    for (; i + 32 <= view.size(); i += 32) {
+      __m256i v = _mm256_loadu_si256(
+          reinterpret_cast<const __m256i*>(view.data() + i));
+      // U+0009 TAB or U+0020 SPACE to U+007E (~). Bytes above 0x7F are
+      // negative and fail the signed comparison with 0x1F.
+      __m256i ascii = _mm256_or_si256(
+          _mm256_cmpeq_epi8(v, tab),
+          _mm256_and_si256(_mm256_cmpgt_epi8(v, below_space),
+                           _mm256_cmpgt_epi8(delete_char, v)));
+      // U+0080 to U+00FF are encoded as C2 or C3 followed by 80 to BF.
+      __m256i lead = _mm256_or_si256(_mm256_cmpeq_epi8(v, lead_c2),
+                                     _mm256_cmpeq_epi8(v, lead_c3));
+      __m256i cont =
+          _mm256_cmpeq_epi8(_mm256_and_si256(v, top_bits), continuation);
+      // The lead flags shifted by one byte, across the two 128-bit lanes.
+      __m256i shifted = _mm256_alignr_epi8(
+          lead, _mm256_permute2x128_si256(previous_lead, lead, 0x21), 15);
+      error = _mm256_or_si256(
+          error,
+          _mm256_or_si256(
+              _mm256_xor_si256(cont, shifted),
+              _mm256_cmpeq_epi8(
+                  _mm256_or_si256(ascii, _mm256_or_si256(lead, cont)), zero)));
+      previous_lead = lead;
+    }
+    if (!_mm256_testz_si256(error, error)) {
+      return false;
+    }
+    // A two-byte sequence may straddle the end of the last vector.
+    if (i > 0 && (uint8_t(view[i - 1]) & 0xFE) == 0xC2) {
+      if (i == view.size() || !is_utf8_continuation(uint8_t(view[i]))) {
+        return false;
+      }
+      i++;
+    }
+    return contains_only_http_quoted_string_tokens_scalar(view.substr(i));
+  }
+
+  bool to_lower_ascii(char* input, size_t length) const noexcept override {
+    // 'A' to 'Z' become -128 to -103 once 0x3F is added, and nothing else
+    // does.
+    const __m256i offset = _mm256_set1_epi8(0x3F);
+    const __m256i bound = _mm256_set1_epi8(-102);
+    const __m256i case_bit = _mm256_set1_epi8(0x20);
+    __m256i non_ascii = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 32 <= length; i += 32) {
+      __m256i v =
+          _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input + i));
+      non_ascii = _mm256_or_si256(non_ascii, v);
+      __m256i upper = _mm256_cmpgt_epi8(bound, _mm256_add_epi8(v, offset));
+      v = _mm256_or_si256(v, _mm256_and_si256(upper, case_bit));
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(input + i), v);
+    }
+    bool ascii = to_lower_ascii_scalar(input + i, length - i);
+    return ascii && _mm256_movemask_epi8(non_ascii) == 0;
+  }
+};
+
+const ada::mimesniff::implementation& get_implementation() noexcept {
+  static const implementation singleton{};
+  return singleton;
+}
+
+}  // namespace ada::mimesniff::avx2
+
+ADA_MIMESNIFF_UNTARGET_REGION
+
+#endif  // ADA_MIMESNIFF_IS_X86_64
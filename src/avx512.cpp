@@ -0,0 +1,152 @@
+#include "ada/mimesniff/portability.h"
+
+#if ADA_MIMESNIFF_IS_X86_64
+
+#include <cstdint>
+#include <string_view>
+
+#include <immintrin.h>
+
+#include "ada/mimesniff/implementation.h"
+#include "ada/mimesniff/scanner.h"
+#include "ada/mimesniff/util-inl.h"
+#include "ada/mimesniff/util.h"
+
+ADA_MIMESNIFF_TARGET_REGION("avx512f,avx512bw,avx2")
+
+namespace ada::mimesniff::avx512 {
+
+namespace {
+
+inline __m512i broadcast_table(const uint8_t (&table)[16]) {
+  return _mm512_maskz_broadcast_i32x4(
+      0xFFFF, _mm_loadu_si128(reinterpret_cast<const __m128i*>(table)));
+}
+
+// The mask of the first `length` bytes of a 64-byte vector. Masked loads do
+// not touch the bytes past the end, so no tail needs special care.
+inline __mmask64 prefix_mask(size_t length) {
+  return length >= 64 ? ~uint64_t(0) : (uint64_t(1) << length) - 1;
+}
+
+inline uint64_t equal_mask(__m512i v, char c) {
+  return _mm512_cmpeq_epi8_mask(v, _mm512_set1_epi8(c));
+}
+
+}  // namespace
+
+class implementation final : public ada::mimesniff::implementation {
+ public:
+  constexpr implementation() noexcept
+      : ada::mimesniff::implementation("avx512", "Intel/AMD AVX-512 (F, BW)",
+                                       instruction_set::avx512, 64) {}
+
+  void classify_structural_block(
+      const char* block, size_t length,
+      structural_masks& masks) const noexcept override {
+    // Masked-off bytes are zero, which belong to no class.
+    __m512i v = _mm512_maskz_loadu_epi8(prefix_mask(length), block);
+    masks.slash = equal_mask(v, '/');
+    masks.semicolon = equal_mask(v, ';');
+    masks.equals = equal_mask(v, '=');
+    masks.quote = equal_mask(v, '"');
+    masks.backslash = equal_mask(v, '\\');
+    masks.whitespace = equal_mask(v, ' ') | equal_mask(v, '\t') |
+                       equal_mask(v, '\r') | equal_mask(v, '\n');
+  }
+
+  uint8_t http_tokens_map(std::string_view view) const noexcept override {
+    const __m512i lower_table = broadcast_table(token_nibble_lookup.lower);
+    const __m512i symbol_table = broadcast_table(token_nibble_lookup.symbol);
+    const __m512i upper_table = broadcast_table(token_nibble_lookup.upper);
+    const __m512i high_table = broadcast_table(token_nibble_lookup.high);
+    const __m512i nibble = _mm512_set1_epi8(0x0F);
+    uint64_t any_lower = 0, any_symbol = 0, any_upper = 0, any_other = 0;
+    for (size_t i = 0; i < view.size(); i += 64) {
+      __mmask64 valid = prefix_mask(view.size() - i);
+      __m512i v = _mm512_maskz_loadu_epi8(valid, view.data() + i);
+      __m512i low = _mm512_and_si512(v, nibble);
+      __m512i high = _mm512_shuffle_epi8(
+          high_table, _mm512_and_si512(_mm512_srli_epi16(v, 4), nibble));
+      uint64_t lower = _mm512_mask_test_epi8_mask(
+          valid, _mm512_shuffle_epi8(lower_table, low), high);
+      uint64_t symbol = _mm512_mask_test_epi8_mask(
+          valid, _mm512_shuffle_epi8(symbol_table, low), high);
+      uint64_t upper = _mm512_mask_test_epi8_mask(
+          valid, _mm512_shuffle_epi8(upper_table, low), high);
+      any_lower |= lower;
+      any_symbol |= symbol;
+      any_upper |= upper;
+      any_other |= valid & ~(lower | symbol | upper);
+    }
+    uint8_t token = 0;
+    token |= any_lower ? 1 : 0;
+    token |= any_symbol ? 2 : 0;
+    token |= any_upper ? 4 : 0;
+    token |= any_other ? 128 : 0;
+    return token;
+  }
+
+  bool contains_only_http_quoted_string_tokens(
+      std::string_view view) const noexcept override {
+    const __m512i tab = _mm512_set1_epi8('\t');
+    const __m512i below_space = _mm512_set1_epi8(0x1F);
+    const __m512i delete_char = _mm512_set1_epi8(0x7F);
+    const __m512i lead_c2 = _mm512_set1_epi8(char(0xC2));
+    const __m512i lead_c3 = _mm512_set1_epi8(char(0xC3));
+    const __m512i top_bits = _mm512_set1_epi8(char(0xC0));
+    const __m512i continuation = _mm512_set1_epi8(char(0x80));
+    uint64_t previous_lead = 0;
+    for (size_t i = 0; i < view.size(); i += 64) {
+      __mmask64 valid = prefix_mask(view.size() - i);
+      __m512i v = _mm512_maskz_loadu_epi8(valid, view.data() + i);
+      // U+0009 TAB or U+0020 SPACE to U+007E (~). Bytes above 0x7F are
+      // negative and fail the signed comparison with 0x1F.
+      uint64_t ascii = _mm512_cmpeq_epi8_mask(v, tab) |
+                       (_mm512_cmpgt_epi8_mask(v, below_space) &
+                        _mm512_cmplt_epi8_mask(v, delete_char));
+      // U+0080 to U+00FF are encoded as C2 or C3 followed by 80 to BF.
+      uint64_t lead = _mm512_cmpeq_epi8_mask(v, lead_c2) |
+                      _mm512_cmpeq_epi8_mask(v, lead_c3);
+      uint64_t cont = _mm512_cmpeq_epi8_mask(_mm512_and_si512(v, top_bits),
+                                             continuation);
+      // Every continuation byte follows a lead byte and every lead byte is
+      // followed by a continuation byte. The masked-off bytes are never
+      // continuation bytes, so a lead byte at the very end is an error.
+      uint64_t shifted = (lead << 1) | previous_lead;
+      if ((valid & ~(ascii | lead | cont)) | (cont ^ shifted)) {
+        return false;
+      }
+      previous_lead = lead >> 63;
+    }
+    return previous_lead == 0;
+  }
+
+  bool to_lower_ascii(char* input, size_t length) const noexcept override {
+    const __m512i a = _mm512_set1_epi8('A');
+    const __m512i letters = _mm512_set1_epi8(26);
+    const __m512i case_bit = _mm512_set1_epi8(0x20);
+    uint64_t non_ascii = 0;
+    for (size_t i = 0; i < length; i += 64) {
+      __mmask64 valid = prefix_mask(length - i);
+      __m512i v = _mm512_maskz_loadu_epi8(valid, input + i);
+      non_ascii |= _mm512_movepi8_mask(v);
+      __mmask64 upper =
+          _mm512_cmplt_epu8_mask(_mm512_sub_epi8(v, a), letters);
+      _mm512_mask_storeu_epi8(input + i, valid,
+                              _mm512_mask_add_epi8(v, upper, v, case_bit));
+    }
+    return non_ascii == 0;
+  }
+};
+
+const ada::mimesniff::implementation& get_implementation() noexcept {
+  static const implementation singleton{};
+  return singleton;
+}
+
+}  // namespace ada::mimesniff::avx512
+
+ADA_MIMESNIFF_UNTARGET_REGION
+
+#endif  // ADA_MIMESNIFF_IS_X86_64
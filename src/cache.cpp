@@ -0,0 +1,277 @@
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+#include "ada/mimesniff/cache.h"
+#include "ada/mimesniff/mimetype.h"
+#include "ada/mimesniff/parser.h"
+
+namespace ada::mimesniff {
+
+uint64_t hash_bytes(std::string_view input) noexcept {
+  constexpr uint64_t multiplier = 0x9E3779B97F4A7C15ull;
+  uint64_t hash = uint64_t(input.size()) * multiplier;
+  size_t i = 0;
+  for (; i + 8 <= input.size(); i += 8) {
+    uint64_t word;
+    std::memcpy(&word, input.data() + i, sizeof(word));
+    hash = (hash ^ word) * multiplier;
+    hash ^= hash >> 32;
+  }
+  if (i < input.size()) {
+    uint64_t word = 0;
+    std::memcpy(&word, input.data() + i, input.size() - i);
+    hash = (hash ^ word) * multiplier;
+    hash ^= hash >> 32;
+  }
+  // The finalizer of MurmurHash3, so that every bit of the input affects the
+  // low bits used by the hash tables.
+  hash ^= hash >> 33;
+  hash *= 0xFF51AFD7ED558CCDull;
+  hash ^= hash >> 33;
+  hash *= 0xC4CEB9FE1A85EC53ull;
+  hash ^= hash >> 33;
+  return hash;
+}
+
+mime_type_cache::mime_type_cache(size_t capacity, size_t shard_count)
+    : shard_count_(std::max<size_t>(shard_count, 1)),
+      shard_capacity_(std::max<size_t>(
+          (capacity + shard_count_ - 1) / shard_count_, 1)),
+      shards_(new shard[shard_count_]) {
+  size_t table_size = 1;
+  while (table_size < 2 * shard_capacity_) {
+    table_size *= 2;
+  }
+  for (size_t i = 0; i < shard_count_; i++) {
+    shard& s = shards_[i];
+    s.table.reset(new std::atomic<node*>[table_size]);
+    for (size_t j = 0; j < table_size; j++) {
+      s.table[j].store(nullptr, std::memory_order_relaxed);
+    }
+    s.table_mask = table_size - 1;
+    s.clock.reserve(shard_capacity_);
+  }
+}
+
+mime_type_cache::~mime_type_cache() {
+  for (size_t i = 0; i < shard_count_; i++) {
+    for (node* n : shards_[i].clock) {
+      delete n;
+    }
+  }
+  for (const retired_node& r : retired_) {
+    delete r.evicted;
+  }
+}
+
+mime_type_cache::shard& mime_type_cache::shard_of(
+    uint64_t hash) const noexcept {
+  // The high bits pick the shard, the low bits the slot within its table.
+  return shards_[(hash >> 32) % shard_count_];
+}
+
+const mime_type_cache::node* mime_type_cache::find(
+    const shard& s, uint64_t hash, std::string_view input) noexcept {
+  // While a writer shifts entries back after an eviction, an entry may be
+  // missed, which only sends the caller to the locked path. A node that is
+  // found is immutable and is not freed before the session calls again.
+  size_t i = hash & s.table_mask;
+  for (size_t probes = 0; probes <= s.table_mask; probes++) {
+    const node* n = s.table[i].load(std::memory_order_acquire);
+    if (n == nullptr) {
+      return nullptr;
+    }
+    if (n->hash == hash && n->key == input) {
+      return n;
+    }
+    i = (i + 1) & s.table_mask;
+  }
+  return nullptr;
+}
+
+void mime_type_cache::erase(shard& s, const node* victim) noexcept {
+  size_t mask = s.table_mask;
+  size_t hole = victim->hash & mask;
+  while (s.table[hole].load(std::memory_order_relaxed) != victim) {
+    hole = (hole + 1) & mask;
+  }
+  // Shifts back the entries of the run that probing would no longer reach.
+  for (size_t j = (hole + 1) & mask;; j = (j + 1) & mask) {
+    node* n = s.table[j].load(std::memory_order_relaxed);
+    if (n == nullptr) {
+      break;
+    }
+    size_t home = n->hash & mask;
+    if (((j - home) & mask) >= ((j - hole) & mask)) {
+      s.table[hole].store(n, std::memory_order_release);
+      hole = j;
+    }
+  }
+  s.table[hole].store(nullptr, std::memory_order_release);
+}
+
+const mime_type_cache::node* mime_type_cache::insert(uint64_t hash,
+                                                     std::string_view input) {
+  // Parsing happens outside of the lock.
+  auto fresh = std::make_unique<node>();
+  fresh->hash = hash;
+  fresh->key.assign(input.data(), input.size());
+  fresh->valid = parse_mime_type_into(fresh->value, input);
+
+  shard& s = shard_of(hash);
+  std::vector<node*> evicted;
+  const node* result;
+  {
+    std::lock_guard<std::mutex> lock(s.mutex);
+    // Another thread may have inserted the same input in the meantime.
+    result = find(s, hash, input);
+    if (result == nullptr) {
+      if (s.clock.size() < shard_capacity_) {
+        s.clock.push_back(fresh.get());
+      } else {
+        // CLOCK: give every referenced entry a second chance.
+        while (s.clock[s.hand]->referenced.exchange(
+            false, std::memory_order_relaxed)) {
+          s.hand = (s.hand + 1) % shard_capacity_;
+        }
+        erase(s, s.clock[s.hand]);
+        evicted.push_back(s.clock[s.hand]);
+        s.clock[s.hand] = fresh.get();
+        s.hand = (s.hand + 1) % shard_capacity_;
+        s.evictions++;
+      }
+      size_t i = hash & s.table_mask;
+      while (s.table[i].load(std::memory_order_relaxed) != nullptr) {
+        i = (i + 1) & s.table_mask;
+      }
+      // Publishes the node, which is complete.
+      s.table[i].store(fresh.get(), std::memory_order_release);
+      result = fresh.release();
+    }
+  }
+  if (!evicted.empty()) {
+    retire(evicted);
+  }
+  return result;
+}
+
+void mime_type_cache::retire(const std::vector<node*>& evicted) {
+  // The nodes are unlinked: a session that sees the new epoch cannot reach
+  // them any more.
+  uint64_t epoch = epoch_.fetch_add(1, std::memory_order_acq_rel) + 1;
+  std::lock_guard<std::mutex> lock(readers_mutex_);
+  for (node* n : evicted) {
+    retired_.push_back({n, epoch});
+  }
+  reclaim();
+}
+
+void mime_type_cache::reclaim() {
+  uint64_t oldest = offline;
+  for (const auto& reader : readers_) {
+    oldest = std::min(oldest, reader->epoch.load(std::memory_order_acquire));
+  }
+  auto kept = std::partition(
+      retired_.begin(), retired_.end(),
+      [oldest](const retired_node& r) { return r.epoch > oldest; });
+  for (auto it = kept; it != retired_.end(); ++it) {
+    delete it->evicted;
+  }
+  retired_.erase(kept, retired_.end());
+}
+
+mime_type_cache::session::session(mime_type_cache& cache)
+    : cache_(cache), slot_([&cache]() -> reader_slot& {
+        std::lock_guard<std::mutex> lock(cache.readers_mutex_);
+        for (const auto& reader : cache.readers_) {
+          if (!reader->in_use) {
+            reader->in_use = true;
+            return *reader;
+          }
+        }
+        cache.readers_.push_back(std::make_unique<reader_slot>());
+        cache.readers_.back()->in_use = true;
+        return *cache.readers_.back();
+      }()) {}
+
+mime_type_cache::session::~session() {
+  std::lock_guard<std::mutex> lock(cache_.readers_mutex_);
+  cache_.past_hits_ += slot_.hits.load(std::memory_order_relaxed);
+  cache_.past_misses_ += slot_.misses.load(std::memory_order_relaxed);
+  slot_.hits.store(0, std::memory_order_relaxed);
+  slot_.misses.store(0, std::memory_order_relaxed);
+  slot_.epoch.store(offline, std::memory_order_release);
+  slot_.in_use = false;
+  cache_.reclaim();
+}
+
+const mimetype* mime_type_cache::session::parse(std::string_view input) {
+  // The records returned before are released, and the nodes unlinked before
+  // this epoch can no longer be found.
+  slot_.epoch.store(cache_.epoch_.load(std::memory_order_acquire),
+                    std::memory_order_release);
+  auto count = [](std::atomic<uint64_t>& counter) {
+    counter.store(counter.load(std::memory_order_relaxed) + 1,
+                  std::memory_order_relaxed);
+  };
+  if (input.size() > max_cached_input_size) {
+    count(slot_.misses);
+    return parse_mime_type_into(uncached_, input) ? &uncached_ : nullptr;
+  }
+  uint64_t hash = hash_bytes(input);
+  const node* n = find(cache_.shard_of(hash), hash, input);
+  if (n != nullptr) {
+    count(slot_.hits);
+    // Avoid writing to the node when the bit is already set.
+    if (!n->referenced.load(std::memory_order_relaxed)) {
+      n->referenced.store(true, std::memory_order_relaxed);
+    }
+  } else {
+    count(slot_.misses);
+    n = cache_.insert(hash, input);
+  }
+  return n->valid ? &n->value : nullptr;
+}
+
+mime_type_cache::statistics mime_type_cache::stats() const {
+  statistics result{};
+  {
+    std::lock_guard<std::mutex> lock(readers_mutex_);
+    result.hits = past_hits_;
+    result.misses = past_misses_;
+    for (const auto& reader : readers_) {
+      result.hits += reader->hits.load(std::memory_order_relaxed);
+      result.misses += reader->misses.load(std::memory_order_relaxed);
+    }
+  }
+  for (size_t i = 0; i < shard_count_; i++) {
+    shard& s = shards_[i];
+    std::lock_guard<std::mutex> lock(s.mutex);
+    result.evictions += s.evictions;
+    result.size += s.clock.size();
+  }
+  return result;
+}
+
+void mime_type_cache::clear() {
+  std::vector<node*> evicted;
+  for (size_t i = 0; i < shard_count_; i++) {
+    shard& s = shards_[i];
+    std::lock_guard<std::mutex> lock(s.mutex);
+    for (size_t j = 0; j <= s.table_mask; j++) {
+      s.table[j].store(nullptr, std::memory_order_release);
+    }
+    evicted.insert(evicted.end(), s.clock.begin(), s.clock.end());
+    s.clock.clear();
+    s.hand = 0;
+  }
+  if (!evicted.empty()) {
+    retire(evicted);
+  }
+}
+
+}  // namespace ada::mimesniff
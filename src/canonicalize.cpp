@@ -0,0 +1,251 @@
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string_view>
+
+#include "ada/mimesniff/canonicalize.h"
+#include "ada/mimesniff/mimetype.h"
+#include "ada/mimesniff/parameter_name_set.h"
+#include "ada/mimesniff/parser-inl.h"
+#include "ada/mimesniff/util-inl.h"
+#include "ada/mimesniff/util.h"
+
+namespace ada::mimesniff {
+
+namespace {
+
+// Calls f on each byte of the value as it is once unescaped.
+template <typename function>
+void for_each_unescaped_byte(std::string_view raw, bool escaped, function f) {
+  for (size_t i = 0; i < raw.size(); i++) {
+    if (escaped && raw[i] == '\\' && i + 1 < raw.size()) {
+      i++;
+    }
+    f(raw[i]);
+  }
+}
+
+// Whether the unescaped value solely contains HTTP quoted-string token code
+// points, without materializing it.
+bool is_valid_parameter_value(std::string_view raw, bool escaped) {
+  return escaped ? escaped_contains_only_http_quoted_string_tokens(raw)
+                 : contains_only_http_quoted_string_tokens(raw);
+}
+
+// The size of "value" or of "\"value\"" with escapes, for the unescaped value.
+size_t serialized_value_size(std::string_view raw, bool escaped) {
+  if (!escaped) {
+    if (!needs_quoting(raw)) {
+      return raw.size();
+    }
+    size_t size = raw.size() + 2;
+    for (char c : raw) {
+      size += (c == '"' || c == '\\');
+    }
+    return size;
+  }
+  size_t length = 0;
+  size_t escapes = 0;
+  bool token = true;
+  for_each_unescaped_byte(raw, escaped, [&](char c) {
+    length++;
+    escapes += (c == '"' || c == '\\');
+    token = token && !(http_tokens_map_table[uint8_t(c)] & 128);
+  });
+  return (length == 0 || !token) ? length + 2 + escapes : length;
+}
+
+// First pass: computes the size of the result without writing anything.
+struct canonical_size_counter {
+  const parameter_edit& edit;
+  std::string_view edit_name;
+  size_t size{0};
+  bool edited{false};
+  // The names of the parameters kept so far, as they appear in the input.
+  parameter_name_set names{};
+
+  void on_essence(std::string_view type, uint8_t, std::string_view subtype,
+                  uint8_t) {
+    size = type.size() + 1 + subtype.size();
+  }
+
+  void on_parameter(std::string_view name, uint8_t, std::string_view value,
+                    bool escaped) {
+    if (!is_valid_parameter_value(value, escaped) || names.contains(name)) {
+      return;
+    }
+    names.insert(name);
+    if (!edit_name.empty() && equals_ignoring_ascii_case(name, edit_name)) {
+      edited = true;
+      if (edit.value.has_value()) {
+        size += 2 + name.size() + serialized_value_size(*edit.value, false);
+      }
+      return;
+    }
+    size += 2 + name.size() + serialized_value_size(value, escaped);
+  }
+
+  size_t total() const noexcept {
+    if (!edited && !edit_name.empty() && edit.value.has_value()) {
+      return size + 2 + edit_name.size() +
+             serialized_value_size(*edit.value, false);
+    }
+    return size;
+  }
+};
+
+// Second pass: packs the components at the front of the buffer, as
+// "type/subtype\0name\0value...". The packed bytes of a component are never
+// more than its bytes in the input, so writes never overtake the parser.
+//
+// The edit is applied here as well: a removed parameter is dropped, and the
+// parameter to set keeps an empty value that is replaced when serializing.
+// This way, no parameter is serialized into fewer bytes than it is packed
+// into.
+struct in_place_packer {
+  char* buffer;
+  const parameter_edit& edit;
+  size_t size{0};
+  size_t essence_length{0};
+
+  char* write(std::string_view bytes) noexcept {
+    char* position = buffer + size;
+    std::memmove(position, bytes.data(), bytes.size());
+    size += bytes.size();
+    return position;
+  }
+
+  void on_essence(std::string_view type, uint8_t, std::string_view subtype,
+                  uint8_t) {
+    // The type may move left past leading whitespace. The subtype then
+    // follows it.
+    write(type);
+    buffer[size++] = '/';
+    write(subtype);
+    to_lower_ascii(buffer, size);
+    essence_length = size;
+  }
+
+  void on_parameter(std::string_view name, uint8_t name_map,
+                    std::string_view value, bool escaped) {
+    size_t rollback = size;
+    buffer[size++] = '\0';
+    char* lowered_name = write(name);
+    if (name_map & 4) {
+      to_lower_ascii_short(lowered_name, name.size());
+    }
+    buffer[size++] = '\0';
+    char* copied_value = write(value);
+    if (escaped) {
+      // Unescaping only moves bytes to the left.
+      size = size_t(copied_value - buffer) +
+             unescape_http_quoted_string(
+                 std::string_view(copied_value, value.size()), copied_value);
+    }
+    std::string_view parameter_name(lowered_name, name.size());
+    std::string_view parameter_value(
+        copied_value, size - size_t(copied_value - buffer));
+    if (!contains_only_http_quoted_string_tokens(parameter_value) ||
+        names.contains(parameter_name)) {
+      size = rollback;
+      return;
+    }
+    if (!edit.name.empty() && parameter_name == edit.name) {
+      if (!edit.value.has_value()) {
+        // Any later duplicate is removed all the same.
+        size = rollback;
+        return;
+      }
+      size = size_t(copied_value - buffer);
+    }
+    names.insert(parameter_name);
+  }
+
+  // The names of the parameters packed so far, which do not move.
+  parameter_name_set names{};
+};
+
+// Writes bytes that may overlap the source, which is never before the
+// destination.
+char* move_bytes(char* output, std::string_view bytes) noexcept {
+  std::memmove(output, bytes.data(), bytes.size());
+  return output + bytes.size();
+}
+
+char* write_parameter(char* output, std::string_view name,
+                      std::string_view value) noexcept {
+  // The value is inspected before any of it is overwritten.
+  bool quoted = needs_quoting(value);
+  *output++ = ';';
+  output = move_bytes(output, name);
+  *output++ = '=';
+  if (!quoted) {
+    return move_bytes(output, value);
+  }
+  *output++ = '"';
+  size_t run_start = 0;
+  for (size_t j = 0; j < value.size(); j++) {
+    if (value[j] == '"' || value[j] == '\\') {
+      output = move_bytes(output, value.substr(run_start, j - run_start));
+      *output++ = '\\';
+      run_start = j;
+    }
+  }
+  output = move_bytes(output, value.substr(run_start));
+  *output++ = '"';
+  return output;
+}
+
+}  // namespace
+
+std::optional<size_t> canonicalize_in_place(char* buffer, size_t length,
+                                            size_t capacity,
+                                            const parameter_edit& edit) {
+  if (!edit.name.empty() &&
+      ((http_tokens_map(edit.name) & (128 | 4)) ||
+       (edit.value.has_value() &&
+        !contains_only_http_quoted_string_tokens(*edit.value)))) {
+    return std::nullopt;
+  }
+  std::string_view input(buffer, length);
+  canonical_size_counter counter{edit, edit.name};
+  if (!parse_mime_type_components(input, counter)) {
+    return std::nullopt;
+  }
+  size_t result_size = counter.total();
+  if (result_size > capacity) {
+    return std::nullopt;
+  }
+
+  in_place_packer packer{buffer, edit};
+  parse_mime_type_components(input, packer);
+
+  // Move the packed bytes to the end of the buffer and serialize them from
+  // the front. Every parameter takes at least as many bytes serialized as
+  // packed, so the output is the furthest ahead of the packed bytes at the
+  // end, where it is at most `capacity - packed size` bytes ahead: it never
+  // overtakes what is left to read.
+  size_t packed_size = packer.size;
+  char* packed = buffer + capacity - packed_size;
+  std::memmove(packed, buffer, packed_size);
+  size_t essence_length = packer.essence_length;
+  char* output = move_bytes(buffer, std::string_view(packed, essence_length));
+  bool edited = false;
+  for (const auto& p : packed_parameter_list{
+           std::string_view(packed + essence_length,
+                            packed_size - essence_length),
+           0}) {
+    if (!edit.name.empty() && p.first == edit.name) {
+      edited = true;
+      output = write_parameter(output, p.first, *edit.value);
+      continue;
+    }
+    output = write_parameter(output, p.first, p.second);
+  }
+  if (!edited && !edit.name.empty() && edit.value.has_value()) {
+    output = write_parameter(output, edit.name, *edit.value);
+  }
+  return size_t(output - buffer);
+}
+
+}  // namespace ada::mimesniff
@@ -0,0 +1,191 @@
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <string_view>
+#include <vector>
+
+#include "ada/mimesniff/implementation.h"
+#include "ada/mimesniff/portability.h"
+#include "ada/mimesniff/util.h"
+
+#if ADA_MIMESNIFF_IS_X86_64
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+namespace ada::mimesniff {
+
+namespace scalar {
+const implementation& get_implementation() noexcept;
+}
+#if ADA_MIMESNIFF_IS_X86_64
+namespace sse42 {
+const implementation& get_implementation() noexcept;
+}
+namespace avx2 {
+const implementation& get_implementation() noexcept;
+}
+namespace avx512 {
+const implementation& get_implementation() noexcept;
+}
+#elif ADA_MIMESNIFF_IS_ARM64
+namespace neon {
+const implementation& get_implementation() noexcept;
+}
+#endif
+
+namespace {
+
+#if ADA_MIMESNIFF_IS_X86_64
+
+void cpuid(uint32_t leaf, uint32_t registers[4]) noexcept {
+#if defined(_MSC_VER)
+  int values[4];
+  __cpuidex(values, int(leaf), 0);
+  for (int i = 0; i < 4; i++) {
+    registers[i] = uint32_t(values[i]);
+  }
+#else
+  __cpuid_count(leaf, 0, registers[0], registers[1], registers[2],
+                registers[3]);
+#endif
+}
+
+// The register state the operating system saves on context switches.
+uint64_t xgetbv() noexcept {
+#if defined(_MSC_VER)
+  return _xgetbv(0);
+#else
+  uint32_t eax, edx;
+  __asm__ __volatile__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+  return (uint64_t(edx) << 32) | eax;
+#endif
+}
+
+uint32_t detect_supported_instruction_sets() noexcept {
+  uint32_t registers[4];  // eax, ebx, ecx, edx
+  cpuid(0, registers);
+  uint32_t max_leaf = registers[0];
+  uint32_t supported = 0;
+  cpuid(1, registers);
+  if (registers[2] & (1u << 20)) {
+    supported |= instruction_set::sse42;
+  }
+  bool osxsave = registers[2] & (1u << 27);
+  if (!osxsave || max_leaf < 7) {
+    return supported;
+  }
+  uint64_t xcr0 = xgetbv();
+  bool ymm_state = (xcr0 & 0x6) == 0x6;
+  bool zmm_state = (xcr0 & 0xE6) == 0xE6;
+  cpuid(7, registers);
+  if (ymm_state && (registers[1] & (1u << 5))) {
+    supported |= instruction_set::avx2;
+  }
+  // AVX-512 F and BW.
+  constexpr uint32_t avx512_bits = (1u << 16) | (1u << 30);
+  if (zmm_state && (registers[1] & avx512_bits) == avx512_bits) {
+    supported |= instruction_set::avx512;
+  }
+  return supported;
+}
+
+#elif ADA_MIMESNIFF_IS_ARM64
+
+uint32_t detect_supported_instruction_sets() noexcept {
+  return instruction_set::neon;
+}
+
+#else
+
+uint32_t detect_supported_instruction_sets() noexcept { return 0; }
+
+#endif
+
+uint32_t supported_instruction_sets() noexcept {
+  static const uint32_t supported = detect_supported_instruction_sets();
+  return supported;
+}
+
+const implementation* detect_best_supported_implementation() noexcept {
+  if (const char* forced = std::getenv("ADA_MIMESNIFF_FORCE_IMPLEMENTATION")) {
+    const implementation* impl = get_implementation(forced);
+    if (impl != nullptr && impl->supported_by_runtime_system()) {
+      return impl;
+    }
+  }
+  const auto& available = get_available_implementations();
+  for (auto it = available.rbegin(); it != available.rend(); ++it) {
+    if ((*it)->supported_by_runtime_system()) {
+      return *it;
+    }
+  }
+  return &scalar::get_implementation();
+}
+
+std::atomic<const implementation*>& active_implementation() noexcept {
+  static std::atomic<const implementation*> active{
+      detect_best_supported_implementation()};
+  return active;
+}
+
+}  // namespace
+
+bool implementation::supported_by_runtime_system() const noexcept {
+  uint32_t required = required_instruction_sets();
+  return (supported_instruction_sets() & required) == required;
+}
+
+const implementation* get_active_implementation() noexcept {
+  return active_implementation().load(std::memory_order_acquire);
+}
+
+bool set_active_implementation(const implementation* impl) noexcept {
+  if (impl == nullptr || !impl->supported_by_runtime_system()) {
+    return false;
+  }
+  active_implementation().store(impl, std::memory_order_release);
+  return true;
+}
+
+const std::vector<const implementation*>& get_available_implementations() {
+  static const std::vector<const implementation*> available{
+      &scalar::get_implementation(),
+#if ADA_MIMESNIFF_IS_X86_64
+      &sse42::get_implementation(),
+      &avx2::get_implementation(),
+      &avx512::get_implementation(),
+#elif ADA_MIMESNIFF_IS_ARM64
+      &neon::get_implementation(),
+#endif
+  };
+  return available;
+}
+
+const implementation* get_implementation(std::string_view name) noexcept {
+  for (const implementation* impl : get_available_implementations()) {
+    if (impl->name() == name) {
+      return impl;
+    }
+  }
+  return nullptr;
+}
+
+uint8_t http_tokens_map_vectorized(std::string_view view) noexcept {
+  return get_active_implementation()->http_tokens_map(view);
+}
+
+bool contains_only_http_quoted_string_tokens_vectorized(
+    std::string_view view) noexcept {
+  return get_active_implementation()->contains_only_http_quoted_string_tokens(
+      view);
+}
+
+bool to_lower_ascii_vectorized(char* input, size_t length) noexcept {
+  return get_active_implementation()->to_lower_ascii(input, length);
+}
+
+}  // namespace ada::mimesniff
@@ -1 +1,11 @@
+#include "cache.cpp"
+#include "canonicalize.cpp"
+#include "implementation.cpp"
+#include "parallel.cpp"
 #include "parser.cpp"
+#include "scalar.cpp"
+#include "sniff.cpp"
+#include "sse42.cpp"
+#include "avx2.cpp"
+#include "avx512.cpp"
+#include "neon.cpp"
@@ -0,0 +1,133 @@
+#include "ada/mimesniff/portability.h"
+
+#if ADA_MIMESNIFF_IS_ARM64
+
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+#include <arm_neon.h>
+
+#include "ada/mimesniff/implementation.h"
+#include "ada/mimesniff/scanner.h"
+#include "ada/mimesniff/util-inl.h"
+#include "ada/mimesniff/util.h"
+
+namespace ada::mimesniff::neon {
+
+namespace {
+
+inline uint8x16_t equal_bytes(uint8x16_t v, uint8_t c) {
+  return vceqq_u8(v, vdupq_n_u8(c));
+}
+
+// Each lane keeps a distinct bit, so adding the lanes of a half packs them.
+inline uint64_t to_mask(uint8x16_t m) {
+  static const uint8_t lanes[16] = {0x01, 0x02, 0x04, 0x08, 0x10, 0x20,
+                                    0x40, 0x80, 0x01, 0x02, 0x04, 0x08,
+                                    0x10, 0x20, 0x40, 0x80};
+  uint8x16_t t = vandq_u8(m, vld1q_u8(lanes));
+  return uint64_t(vaddv_u8(vget_low_u8(t))) |
+         (uint64_t(vaddv_u8(vget_high_u8(t))) << 8);
+}
+
+}  // namespace
+
+class implementation final : public ada::mimesniff::implementation {
+ public:
+  constexpr implementation() noexcept
+      : ada::mimesniff::implementation("neon", "ARM NEON",
+                                       instruction_set::neon, 16) {}
+
+  void classify_structural_block(
+      const char* block, size_t length,
+      structural_masks& masks) const noexcept override {
+    // The last block is padded with zeroes, which belong to no class.
+    char padded[16]{};
+    if (length < 16) {
+      std::memcpy(padded, block, length);
+      block = padded;
+    }
+    uint8x16_t v = vld1q_u8(reinterpret_cast<const uint8_t*>(block));
+    masks.slash = to_mask(equal_bytes(v, '/'));
+    masks.semicolon = to_mask(equal_bytes(v, ';'));
+    masks.equals = to_mask(equal_bytes(v, '='));
+    masks.quote = to_mask(equal_bytes(v, '"'));
+    masks.backslash = to_mask(equal_bytes(v, '\\'));
+    masks.whitespace =
+        to_mask(vorrq_u8(vorrq_u8(equal_bytes(v, ' '), equal_bytes(v, '\t')),
+                         vorrq_u8(equal_bytes(v, '\r'), equal_bytes(v, '\n'))));
+  }
+
+  uint8_t http_tokens_map(std::string_view view) const noexcept override {
+    const uint8x16_t lower_table = vld1q_u8(token_nibble_lookup.lower);
+    const uint8x16_t symbol_table = vld1q_u8(token_nibble_lookup.symbol);
+    const uint8x16_t upper_table = vld1q_u8(token_nibble_lookup.upper);
+    const uint8x16_t high_table = vld1q_u8(token_nibble_lookup.high);
+    const uint8x16_t nibble = vdupq_n_u8(0x0F);
+    uint8x16_t any_lower = vdupq_n_u8(0), any_symbol = vdupq_n_u8(0),
+               any_upper = vdupq_n_u8(0), any_other = vdupq_n_u8(0);
+    size_t i = 0;
+    for (; i + 16 <= view.size(); i += 16) {
+      uint8x16_t v =
+          vld1q_u8(reinterpret_cast<const uint8_t*>(view.data() + i));
+      uint8x16_t low = vandq_u8(v, nibble);
+      uint8x16_t high = vqtbl1q_u8(high_table, vshrq_n_u8(v, 4));
+      uint8x16_t lower = vandq_u8(vqtbl1q_u8(lower_table, low), high);
+      uint8x16_t symbol = vandq_u8(vqtbl1q_u8(symbol_table, low), high);
+      uint8x16_t upper = vandq_u8(vqtbl1q_u8(upper_table, low), high);
+      any_lower = vorrq_u8(any_lower, lower);
+      any_symbol = vorrq_u8(any_symbol, symbol);
+      any_upper = vorrq_u8(any_upper, upper);
+      any_other = vorrq_u8(
+          any_other, vceqzq_u8(vorrq_u8(vorrq_u8(lower, symbol), upper)));
+    }
+    uint8_t token = http_tokens_map_scalar(view.substr(i));
+    token |= vmaxvq_u8(any_lower) ? 1 : 0;
+    token |= vmaxvq_u8(any_symbol) ? 2 : 0;
+    token |= vmaxvq_u8(any_upper) ? 4 : 0;
+    token |= vmaxvq_u8(any_other) ? 128 : 0;
+    return token;
+  }
+
+  bool contains_only_http_quoted_string_tokens(
+      std::string_view view) const noexcept override {
+    // Skip the vectors that only contain U+0020 SPACE to U+007E (~), which is
+    // almost always the whole value.
+    size_t i = 0;
+    for (; i + 16 <= view.size(); i += 16) {
+      uint8x16_t v =
+          vld1q_u8(reinterpret_cast<const uint8_t*>(view.data() + i));
+      if (vminvq_u8(v) < 0x20 || vmaxvq_u8(v) > 0x7E) {
+        break;
+      }
+    }
+    return contains_only_http_quoted_string_tokens_scalar(view.substr(i));
+  }
+
+  bool to_lower_ascii(char* input, size_t length) const noexcept override {
+    const uint8x16_t a = vdupq_n_u8('A');
+    const uint8x16_t letters = vdupq_n_u8(26);
+    const uint8x16_t case_bit = vdupq_n_u8(0x20);
+    uint8x16_t non_ascii = vdupq_n_u8(0);
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16) {
+      uint8x16_t v = vld1q_u8(reinterpret_cast<const uint8_t*>(input + i));
+      non_ascii = vorrq_u8(non_ascii, v);
+      uint8x16_t upper = vcltq_u8(vsubq_u8(v, a), letters);
+      v = vorrq_u8(v, vandq_u8(upper, case_bit));
+      vst1q_u8(reinterpret_cast<uint8_t*>(input + i), v);
+    }
+    bool ascii = to_lower_ascii_scalar(input + i, length - i);
+    return ascii && vmaxvq_u8(non_ascii) < 0x80;
+  }
+};
+
+const ada::mimesniff::implementation& get_implementation() noexcept {
+  static const implementation singleton{};
+  return singleton;
+}
+
+}  // namespace ada::mimesniff::neon
+
+#endif  // ADA_MIMESNIFF_IS_ARM64
@@ -0,0 +1,167 @@
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <string_view>
+#include <thread>
+
+#include "ada/mimesniff/mimetype.h"
+#include "ada/mimesniff/parallel.h"
+#include "ada/mimesniff/parser.h"
+
+namespace ada::mimesniff {
+
+thread_pool::thread_pool(size_t thread_count)
+    : range_count_(std::max<size_t>(thread_count, 1)),
+      ranges_(new task_range[range_count_]) {
+  threads_.reserve(range_count_ - 1);
+  for (size_t i = 1; i < range_count_; i++) {
+    threads_.emplace_back([this, i] { worker_loop(i); });
+  }
+}
+
+thread_pool::~thread_pool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  wake_.notify_all();
+  for (std::thread& thread : threads_) {
+    thread.join();
+  }
+}
+
+size_t thread_pool::default_thread_count() noexcept {
+  return std::max<size_t>(std::thread::hardware_concurrency(), 1);
+}
+
+void thread_pool::run(size_t task_count,
+                      const std::function<void(size_t)>& task) {
+  if (task_count == 0) {
+    return;
+  }
+  std::lock_guard<std::mutex> run_lock(run_mutex_);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < range_count_; i++) {
+      std::lock_guard<std::mutex> range_lock(ranges_[i].mutex);
+      ranges_[i].next = task_count * i / range_count_;
+      ranges_[i].end = task_count * (i + 1) / range_count_;
+    }
+    remaining_.store(task_count, std::memory_order_relaxed);
+    task_ = &task;
+    generation_++;
+  }
+  wake_.notify_all();
+  work(0, task);
+  // The workers must be done with the task before it goes out of scope.
+  std::unique_lock<std::mutex> lock(mutex_);
+  done_.wait(lock, [this] {
+    return busy_ == 0 && remaining_.load(std::memory_order_acquire) == 0;
+  });
+  task_ = nullptr;
+}
+
+void thread_pool::worker_loop(size_t index) {
+  uint64_t seen = 0;
+  while (true) {
+    const std::function<void(size_t)>* task;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      wake_.wait(lock, [this, seen] { return stop_ || generation_ != seen; });
+      if (stop_) {
+        return;
+      }
+      seen = generation_;
+      // A worker that wakes up after the job is over has nothing to do.
+      task = task_;
+      if (task == nullptr) {
+        continue;
+      }
+      busy_++;
+    }
+    work(index, *task);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      busy_--;
+    }
+    done_.notify_all();
+  }
+}
+
+void thread_pool::work(size_t index, const std::function<void(size_t)>& task) {
+  do {
+    size_t task_index;
+    while (pop(index, task_index)) {
+      task(task_index);
+      remaining_.fetch_sub(1, std::memory_order_release);
+    }
+  } while (steal(index));
+}
+
+bool thread_pool::pop(size_t index, size_t& task_index) {
+  task_range& range = ranges_[index];
+  std::lock_guard<std::mutex> lock(range.mutex);
+  if (range.next == range.end) {
+    return false;
+  }
+  task_index = range.next++;
+  return true;
+}
+
+bool thread_pool::steal(size_t index) {
+  for (size_t offset = 1; offset < range_count_; offset++) {
+    task_range& victim = ranges_[(index + offset) % range_count_];
+    size_t begin, end;
+    {
+      std::lock_guard<std::mutex> lock(victim.mutex);
+      if (victim.next == victim.end) {
+        continue;
+      }
+      // The victim keeps the first half, which it works on next.
+      begin = victim.next + (victim.end - victim.next) / 2;
+      end = victim.end;
+      victim.end = begin;
+    }
+    task_range& own = ranges_[index];
+    std::lock_guard<std::mutex> lock(own.mutex);
+    own.next = begin;
+    own.end = end;
+    return true;
+  }
+  return false;
+}
+
+size_t parse_mime_types_parallel(const std::string_view* inputs, size_t count,
+                                 mimetype* results, uint64_t* valid,
+                                 const executor& run) {
+  std::atomic<size_t> valid_count{0};
+  size_t chunk_count = (count + parallel_chunk_size - 1) / parallel_chunk_size;
+  run(chunk_count, [=, &valid_count](size_t chunk) {
+    size_t start = chunk * parallel_chunk_size;
+    size_t length = std::min(parallel_chunk_size, count - start);
+    valid_count.fetch_add(
+        parse_mime_types(inputs + start, length, results + start,
+                         valid + start / 64),
+        std::memory_order_relaxed);
+  });
+  return valid_count.load(std::memory_order_relaxed);
+}
+
+size_t parse_mime_types_parallel(const std::string_view* inputs, size_t count,
+                                 mimetype* results, uint64_t* valid,
+                                 thread_pool& pool) {
+  return parse_mime_types_parallel(
+      inputs, count, results, valid,
+      [&pool](size_t task_count, const std::function<void(size_t)>& task) {
+        pool.run(task_count, task);
+      });
+}
+
+size_t parse_mime_types_parallel(const std::string_view* inputs, size_t count,
+                                 mimetype* results, uint64_t* valid) {
+  static thread_pool pool{};
+  return parse_mime_types_parallel(inputs, count, results, valid, pool);
+}
+
+}  // namespace ada::mimesniff
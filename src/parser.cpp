@@ -1,161 +1,393 @@
+#include <algorithm>
+#include <cstdint>
 #include <map>
+#include <memory_resource>
 #include <optional>
 #include <string>
 
 #include "ada/mimesniff/util-inl.h"
 #include "ada/mimesniff/util.h"
+#include "ada/mimesniff/lazy_mimetype.h"
 #include "ada/mimesniff/mimetype.h"
+#include "ada/mimesniff/mimetype_view.h"
+#include "ada/mimesniff/parameter_name_set.h"
+#include "ada/mimesniff/parser-inl.h"
+#include "ada/mimesniff/parser.h"
 
 namespace ada::mimesniff {
 
-std::optional<mimetype> parse_mime_type(std::string_view input) {
-  // Remove any leading and trailing HTTP whitespace from input.
-  trim_http_whitespace(input);
-
-  auto type_end_position = input.find('/');
-  if (type_end_position == std::string_view::npos) {
-    return std::nullopt;
-  }
-
-  // Let type be the result of collecting a sequence of code points that are not
-  // U+002F (/) from input, given position.
-  std::string_view type = input.substr(0, type_end_position);
-  uint8_t type_map = http_tokens_map(type);
-  // If type is the empty string or does not solely contain HTTP token code
-  // points, then return failure.
-  if (type.empty() || (type_map & 128)) {
-    return std::nullopt;
+template <typename record>
+struct mimetype_builder {
+  record& out;
+  // The canonical bytes are never longer than the input.
+  size_t capacity;
+
+  void on_essence(std::string_view type, uint8_t type_map,
+                  std::string_view subtype, uint8_t subtype_map) {
+    out.data_.reserve(capacity);
+    out.data_ += type;
+    out.data_ += '/';
+    out.data_ += subtype;
+    out.type_length_ = uint32_t(type.size());
+    out.essence_length_ = uint32_t(out.data_.size());
+
+    if ((type_map | subtype_map) & 4) {  // containers uppercase letters
+      to_lower_ascii(out.data_.data(), out.data_.size());
+    }
+    out.essence_id_ = lookup_essence(
+        std::string_view(out.data_).substr(0, out.type_length_),
+        std::string_view(out.data_).substr(out.type_length_ + 1));
   }
 
-  // Remove type from input. (This skips past U+002F (/).)
-  input.remove_prefix(type_end_position + 1);
+  void on_parameter(std::string_view name, uint8_t name_map,
+                    std::string_view value, bool escaped) {
+    // The parameter is appended in place and dropped if it turns out to be
+    // invalid or a duplicate.
+    size_t rollback = out.data_.size();
+    out.data_ += '\0';
+    // A common name is packed as its id, which needs no lowercasing.
+    parameter_name_id id = lookup_parameter_name(name);
+    if (id != parameter_name_id::unknown) {
+      out.data_ += char(id);
+    } else {
+      out.data_ += name;
+      if (name_map & 4) {
+        to_lower_ascii_short(out.data_.data() + rollback + 1, name.size());
+      }
+    }
+    out.data_ += '\0';
+    size_t value_start = out.data_.size();
+    out.data_ += value;
+    if (escaped) {
+      out.data_.resize(value_start +
+                       unescape_http_quoted_string(
+                           value, out.data_.data() + value_start));
+    }
+    // The views are taken after the last append since it may reallocate.
+    std::string_view parameter_name =
+        id != parameter_name_id::unknown
+            ? to_string(id)
+            : std::string_view(out.data_.data() + rollback + 1, name.size());
+    std::string_view parameter_value(out.data_.data() + value_start,
+                                     out.data_.size() - value_start);
 
-  // Optimization: No need to check for string_view::npos subtype_end_position
-  // is used as a second parameter to `std::string_view::substr`.
-  auto subtype_end_position = input.find(';');
+    // If all of the following are true
+    // - parameterValue solely contains HTTP quoted-string token code points
+    // - mimeType’s parameters[parameterName] does not exist
+    if (contains_only_http_quoted_string_tokens(parameter_value) &&
+        !names.contains(parameter_name)) {
+      // then set mimeType’s parameters[parameterName] to parameterValue.
+      out.parameter_count_++;
+      names.insert(parameter_name);
+    } else {
+      out.data_.resize(rollback);
+    }
+  }
 
-  // Let subtype be the result of collecting a sequence of code
-  // points that are not U+003B (;) from input, given position.
-  std::string_view subtype = input.substr(0, subtype_end_position);
+  // The names of the parameters set so far. The buffer was reserved up
+  // front, so they do not move.
+  parameter_name_set& names;
+};
 
-  // Remove any trailing HTTP whitespace from subtype.
-  trim_trailing_http_whitespace(subtype);
+// The memory resource the names of a record go to: that of the record when
+// it has one.
+template <typename allocator>
+std::pmr::memory_resource* name_resource(const allocator&) noexcept {
+  return std::pmr::get_default_resource();
+}
 
-  // Optimization opportunity: Copy is only required if subtype is not
-  // lowercased.
-  uint8_t subtype_map = http_tokens_map(subtype);
+std::pmr::memory_resource* name_resource(
+    const std::pmr::polymorphic_allocator<char>& alloc) noexcept {
+  return alloc.resource();
+}
 
-  // If subtype is the empty string or does not solely contain
-  // HTTP token code points, then return failure.
-  if (subtype.empty() || (subtype_map & 128)) {
+template <typename record>
+std::optional<record> parse_mime_type_impl(
+    std::string_view input, const typename record::allocator_type& alloc,
+    size_t max_parameters = ~size_t(0)) {
+  auto out = record(alloc);
+  parameter_name_set names(name_resource(alloc));
+  mimetype_builder<record> builder{out, input.size(), names};
+  if (!parse_mime_type_components(input, builder, max_parameters)) {
     return std::nullopt;
   }
+  // Return mimeType.
+  return out;
+}
 
-  // Let mimeType be a new MIME type record whose type is type, in ASCII
-  // lowercase, and subtype is subtype, in ASCII lowercase.
-  auto out = mimetype();
-  out.type = type;
-  out.subtype = subtype;
+std::optional<mimetype> parse_mime_type(std::string_view input) {
+  return parse_mime_type_impl<mimetype>(input, {});
+}
 
-  if (type_map & 4) {  // containers uppercase letters
-    to_lower_ascii(out.type.data(), out.type.size());
+std::optional<mimetype> parse_mime_type(std::string_view input,
+                                        const parse_options& options) {
+  if (input.size() > options.max_length) {
+    return std::nullopt;
   }
+  return parse_mime_type_impl<mimetype>(input, {}, options.max_parameters);
+}
 
-  if (subtype_map & 4) {  // containers uppercase letters
-    to_lower_ascii(out.subtype.data(), out.subtype.size());
-  }
+std::optional<pmr::mimetype> parse_mime_type(
+    std::string_view input, std::pmr::memory_resource* resource) {
+  return parse_mime_type_impl<pmr::mimetype>(input, resource);
+}
 
-  // Remove subtype from input
-  input.remove_prefix(subtype_end_position);
+template <typename record>
+bool parse_mime_type_into_impl(record& out, std::string_view input,
+                               parameter_name_set& names) {
+  // Clearing keeps the capacity of the buffer, and that of the names.
+  out.data_.clear();
+  out.type_length_ = 0;
+  out.essence_length_ = 0;
+  out.parameter_count_ = 0;
+  out.essence_id_ = essence_id::unknown;
+  names.clear();
+  mimetype_builder<record> builder{out, input.size(), names};
+  return parse_mime_type_components(input, builder);
+}
 
-  // Reserve memory
-  out.parameters.reserve(2);
+bool parse_mime_type_into(mimetype& out, std::string_view input) {
+  parameter_name_set names{};
+  return parse_mime_type_into_impl(out, input, names);
+}
 
-  // While position is not past the end of input:
-  while (!input.empty()) {
-    // Advance position by 1. (This skips past U+003B (;).)
-    input.remove_prefix(1);
+bool parse_mime_type_into(pmr::mimetype& out, std::string_view input) {
+  parameter_name_set names(name_resource(out.get_allocator()));
+  return parse_mime_type_into_impl(out, input, names);
+}
 
-    // Collect a sequence of code points that are HTTP whitespace from input
-    // given position.
-    while (!input.empty() && is_http_whitespace(input[0])) {
-      input.remove_prefix(1);
-    }
+namespace {
 
-    // Let parameterName be the result of collecting a sequence of code points
-    // that are not U+003B (;) or U+003D (=) from input, given position.
-    auto parameter_name_ending = input.find_first_of(";=");
+inline void prefetch(const void* address) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+  __builtin_prefetch(address);
+#else
+  (void)address;
+#endif
+}
 
-    if (parameter_name_ending == std::string_view::npos) {
-      // Parameter name needs to end with either `;` or `=`
-      // If position is past the end of input, then break.
-      break;
+}  // namespace
+
+size_t parse_mime_types(const std::string_view* inputs, size_t count,
+                        mimetype* results, uint64_t* valid) {
+  // A divisor of 64, so that a group never spans two words of the bitmap.
+  constexpr size_t group_size = 8;
+  size_t valid_count = 0;
+  // Shared by the whole batch, so that it allocates at most a few times.
+  parameter_name_set names{};
+  for (size_t start = 0; start < count; start += group_size) {
+    size_t end = std::min(start + group_size, count);
+    for (size_t i = end; i < std::min(end + group_size, count); i++) {
+      prefetch(inputs[i].data());
+      prefetch(&results[i]);
+    }
+    uint64_t bits = 0;
+    for (size_t i = start; i < end; i++) {
+      bool ok = parse_mime_type_into_impl(results[i], inputs[i], names);
+      bits |= uint64_t(ok) << (i - start);
+      valid_count += ok;
+    }
+    if (start % 64 == 0) {
+      valid[start / 64] = 0;
     }
+    valid[start / 64] |= bits << (start % 64);
+  }
+  return valid_count;
+}
 
-    // Optimization opportunity: Copy is only required if parameter_name is
-    // not lowercased.
-    std::string parameter_name =
-        std::string(input.substr(0, parameter_name_ending));
-    to_lower_ascii_short(parameter_name.data(), parameter_name.size());
-    input.remove_prefix(parameter_name_ending);
+// Checks, piece by piece, that the input reads exactly like the serialization
+// of the MIME type it parses to. Every component is a view into the input, so
+// the pieces must follow each other with no byte left out.
+struct canonical_form_checker {
+  std::string_view input;
+  // Where the next piece must start.
+  const char* cursor{nullptr};
+  bool canonical{true};
+
+  void on_essence(std::string_view type, uint8_t type_map,
+                  std::string_view subtype, uint8_t subtype_map) {
+    // No leading whitespace and no uppercase letters.
+    canonical = type.data() == input.data() && !((type_map | subtype_map) & 4);
+    cursor = subtype.data() + subtype.size();
+  }
 
-    // If the code point at position within input is U+003B (;), then
-    // continue.
-    if (!input.empty() && input[0] == ';') continue;
+  void on_parameter(std::string_view name, uint8_t name_map,
+                    std::string_view value, bool) {
+    if (!canonical) {
+      return;
+    }
+    // ";name=", with the name in lowercase.
+    if (cursor == input.data() + input.size() || *cursor != ';' ||
+        name.data() != cursor + 1 || (name_map & 4)) {
+      canonical = false;
+      return;
+    }
+    const char* value_start = name.data() + name.size() + 1;
+    const char* input_end = input.data() + input.size();
+    if (value.data() == value_start) {
+      // A value is only left unquoted when it is a non-empty token.
+      canonical = contains_only_http_tokens(value);
+      cursor = value.data() + value.size();
+    } else {
+      // A quoted value needs its closing quote, and quotes exactly when the
+      // unescaped value is empty or not a token, escaping nothing but U+0022
+      // (") and U+005C (\).
+      const char* value_end = value.data() + value.size();
+      canonical = value_end != input_end && *value_end == '"' &&
+                  (value.empty() || !contains_only_http_tokens(value)) &&
+                  contains_only_http_quoted_string_tokens(value) &&
+                  has_canonical_escapes(value);
+      cursor = value_end + 1;
+    }
+    // The parameter is dropped if it is a duplicate, so it must not appear in
+    // the canonical prefix checked so far.
+    if (canonical && names.contains(name)) {
+      canonical = false;
+    }
+    names.insert(name);
+  }
 
-    // Advance position by 1. (This skips past U+003D (=).)
-    input.remove_prefix(1);
+  static bool has_canonical_escapes(std::string_view raw) noexcept {
+    for (size_t i = 0; i < raw.size(); i++) {
+      if (raw[i] == '\\') {
+        if (i + 1 == raw.size() ||
+            (raw[i + 1] != '"' && raw[i + 1] != '\\')) {
+          return false;
+        }
+        i++;
+      } else if (raw[i] == '"') {
+        return false;
+      }
+    }
+    return true;
+  }
 
-    // Let parameterValue be null.
-    std::string parameter_value;
+  // The names of the canonical prefix checked so far.
+  parameter_name_set names{};
+};
+
+validation_result validate_mime_type(std::string_view input) {
+  canonical_form_checker checker{input};
+  validation_result result{};
+  result.valid = parse_mime_type_components(input, checker);
+  result.canonical = result.valid && checker.canonical &&
+                     checker.cursor == input.data() + input.size();
+  return result;
+}
 
-    // If the code point at position within input is U+0022 ("), then:
-    if (input[0] == '"') {
-      // Set parameterValue to the result of collecting an HTTP quoted string
-      // from input.
-      parameter_value = collect_http_quoted_string(input);
-      // Collect a sequence of code points that are not U+003B (;) from input,
-      // given position.
-      input.remove_prefix(input.find(';'));
-    } else {
-      // Set parameterValue to the result of collecting a sequence of code
-      // points that are not U+003B (;) from input, given position.
-      auto semicolon_index = input.find(';');
+const mimetype* parser::parse(std::string_view input) {
+  return parse_mime_type_into_impl(result_, input, names_) ? &result_
+                                                          : nullptr;
+}
 
-      std::string_view parameter_value_view = input.substr(0, semicolon_index);
+parser& parser::thread_local_instance() {
+  thread_local parser instance{};
+  return instance;
+}
 
-      // Remove any trailing HTTP whitespace from parameterValue.
-      trim_trailing_http_whitespace(parameter_value_view);
+struct mimetype_view_builder {
+  mimetype_view& out;
+  // Lowercased and unescaped components are never longer than the input, so
+  // a single buffer of that size is enough for all of them.
+  size_t capacity;
+  size_t used{0};
+
+  // Reserves space in the buffer of the view for a component of at most
+  // `length` bytes.
+  char* reserve(size_t length) {
+    if (!out.buffer_) {
+      out.buffer_ = std::unique_ptr<char[]>(new char[capacity]);
+      out.buffer_size_ = capacity;
+    }
+    char* position = out.buffer_.get() + used;
+    used += length;
+    return position;
+  }
 
-      // Collect a sequence of code points that are not U+003B (;) from input,
-      // given position.
-      input.remove_prefix(semicolon_index);
+  std::string_view lowercase(std::string_view view) {
+    char* copy = reserve(view.size());
+    std::copy(view.begin(), view.end(), copy);
+    to_lower_ascii(copy, view.size());
+    return {copy, view.size()};
+  }
 
-      // If parameterValue is the empty string, then continue.
-      if (parameter_value_view.empty()) {
-        continue;
-      }
+  void on_essence(std::string_view type, uint8_t type_map,
+                  std::string_view subtype, uint8_t subtype_map) {
+    out.type_ = (type_map & 4) ? lowercase(type) : type;
+    out.subtype_ = (subtype_map & 4) ? lowercase(subtype) : subtype;
+    out.essence_id_ = lookup_essence(out.type_, out.subtype_);
+  }
 
-      parameter_value = std::string(parameter_value_view);
+  void on_parameter(std::string_view name, uint8_t name_map,
+                    std::string_view value, bool escaped) {
+    // A common name is the static string of its id, in any case.
+    parameter_name_id id = lookup_parameter_name(name);
+    if (id != parameter_name_id::unknown) {
+      name = to_string(id);
+    } else if (name_map & 4) {
+      name = lowercase(name);
+    }
+    if (escaped) {
+      char* unescaped = reserve(value.size());
+      value = {unescaped, unescape_http_quoted_string(value, unescaped)};
     }
 
     // If all of the following are true
-    // - parameterName is not the empty string
-    // - parameterName solely contains HTTP token code points
     // - parameterValue solely contains HTTP quoted-string token code points
     // - mimeType’s parameters[parameterName] does not exist
-    if (!parameter_name.empty() && contains_only_http_tokens(parameter_name) &&
-        contains_only_http_quoted_string_tokens(parameter_value) &&
-        std::none_of(out.parameters.begin(), out.parameters.end(),
-                     [&parameter_name](auto& param) {
-                       return param.first == parameter_name;
-                     })) {
-      // then set mimeType’s parameters[parameterName] to parameterValue.
-      out.parameters.emplace_back(parameter_name, parameter_value);
+    if (contains_only_http_quoted_string_tokens(value) &&
+        !names.contains(name)) {
+      out.add_parameter(name, value);
+      names.insert(name);
     }
   }
 
-  // Return mimeType.
+  // They point into the input or into the buffer of the view.
+  parameter_name_set names{};
+};
+
+std::optional<mimetype_view> parse_mime_type_view(std::string_view input) {
+  auto out = mimetype_view();
+  mimetype_view_builder builder{out, input.size()};
+  if (!parse_mime_type_components(input, builder)) {
+    return std::nullopt;
+  }
+  return out;
+}
+
+std::optional<lazy_mimetype> parse_mime_type_lazy(std::string_view input) {
+  trim_http_whitespace(input);
+  structural_scanner scanner(input);
+  raw_mime_type_essence essence{};
+  if (!parse_mime_type_essence(input, scanner, essence)) {
+    return std::nullopt;
+  }
+  auto out = lazy_mimetype();
+  out.type_length_ = essence.type.size();
+  out.tail_ = input.substr(essence.end);
+  // The type, U+002F (/) and the subtype follow each other in the input.
+  out.essence_ =
+      input.substr(0, essence.type.size() + 1 + essence.subtype.size());
+  if (!((essence.type_map | essence.subtype_map) & 4)) {
+    out.essence_id_ = lookup_essence(essence.type, essence.subtype);
+  } else if (out.essence_.size() <= 64) {
+    // Lowercased on the stack first, so that a well-known essence, which is
+    // never longer, is not copied.
+    char lowered[64];
+    std::copy(out.essence_.begin(), out.essence_.end(), lowered);
+    to_lower_ascii(lowered, out.essence_.size());
+    out.essence_id_ =
+        lookup_essence(std::string_view(lowered, out.essence_.size()));
+    if (out.essence_id_ == essence_id::unknown) {
+      out.lowered_essence_.assign(lowered, out.essence_.size());
+    }
+  } else {
+    out.lowered_essence_ = std::string(out.essence_);
+    to_lower_ascii(out.lowered_essence_.data(), out.lowered_essence_.size());
+  }
+  if (out.essence_id_ != essence_id::unknown) {
+    out.essence_ = to_string(out.essence_id_);
+  }
   return out;
 }
 
@@ -0,0 +1,88 @@
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+#include "ada/mimesniff/implementation.h"
+#include "ada/mimesniff/scanner.h"
+#include "ada/mimesniff/util-inl.h"
+#include "ada/mimesniff/util.h"
+
+namespace ada::mimesniff::scalar {
+
+// Portable code only, to run anywhere and to compare the other
+// implementations against.
+class implementation final : public ada::mimesniff::implementation {
+ public:
+  constexpr implementation() noexcept
+      : ada::mimesniff::implementation("scalar", "Generic 64-bit code", 0,
+                                       16) {}
+
+  void classify_structural_block(
+      const char* block, size_t length,
+      structural_masks& masks) const noexcept override {
+    masks = structural_masks{};
+    for (size_t i = 0; i < length; i++) {
+      uint64_t bit = uint64_t(1) << i;
+      switch (block[i]) {
+        case '/':
+          masks.slash |= bit;
+          break;
+        case ';':
+          masks.semicolon |= bit;
+          break;
+        case '=':
+          masks.equals |= bit;
+          break;
+        case '"':
+          masks.quote |= bit;
+          break;
+        case '\\':
+          masks.backslash |= bit;
+          break;
+        case ' ':
+        case '\t':
+        case '\r':
+        case '\n':
+          masks.whitespace |= bit;
+          break;
+        default:
+          break;
+      }
+    }
+  }
+
+  uint8_t http_tokens_map(std::string_view view) const noexcept override {
+    return http_tokens_map_scalar(view);
+  }
+
+  bool contains_only_http_quoted_string_tokens(
+      std::string_view view) const noexcept override {
+    // Eight bytes at a time, skip the words that only contain U+0020 SPACE to
+    // U+007E (~), which is almost always the whole value.
+    size_t i = 0;
+    for (; i + 8 <= view.size(); i += 8) {
+      uint64_t word;
+      std::memcpy(&word, view.data() + i, sizeof(word));
+      constexpr uint64_t ones = 0x0101010101010101ull;
+      constexpr uint64_t highs = 0x8080808080808080ull;
+      // A byte is below 0x20 or above 0x7E iff it is below 0x20, or adding 1
+      // makes it reach 0x80, or it already is 0x80 or above.
+      uint64_t outside = ((word - ones * 0x20) | (word + ones)) | word;
+      if (outside & highs) {
+        break;
+      }
+    }
+    return contains_only_http_quoted_string_tokens_scalar(view.substr(i));
+  }
+
+  bool to_lower_ascii(char* input, size_t length) const noexcept override {
+    return to_lower_ascii_scalar(input, length);
+  }
+};
+
+const ada::mimesniff::implementation& get_implementation() noexcept {
+  static const implementation singleton{};
+  return singleton;
+}
+
+}  // namespace ada::mimesniff::scalar
@@ -0,0 +1,704 @@
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+#include "ada/mimesniff/byte_pattern.h"
+#include "ada/mimesniff/essence.h"
+#include "ada/mimesniff/portability.h"
+#include "ada/mimesniff/sniff.h"
+
+namespace ada::mimesniff {
+
+namespace {
+
+using namespace std::string_view_literals;
+
+// A row of the HTML table: letters are compared ignoring ASCII case, and the
+// tag must be followed by a tag-terminating byte.
+constexpr byte_pattern html_pattern(std::string_view tag) noexcept {
+  char masks[byte_pattern::max_size]{};
+  for (size_t i = 0; i < tag.size() && i < byte_pattern::max_size; i++) {
+    bool letter = (tag[i] | 0x20) >= 'a' && (tag[i] | 0x20) <= 'z';
+    masks[i] = char(letter ? 0xDF : 0xFF);
+  }
+  return byte_pattern(tag, std::string_view(masks, tag.size()),
+                      essence_id::text_html, true, true);
+}
+
+// https://mimesniff.spec.whatwg.org/#rules-for-identifying-an-unknown-mime-type
+// The HTML rows come first, then the other scriptable ones.
+constexpr std::array<byte_pattern, 17> html_patterns{{
+    html_pattern("<!DOCTYPE HTML"),
+    html_pattern("<HTML"),
+    html_pattern("<HEAD"),
+    html_pattern("<SCRIPT"),
+    html_pattern("<IFRAME"),
+    html_pattern("<H1"),
+    html_pattern("<DIV"),
+    html_pattern("<FONT"),
+    html_pattern("<TABLE"),
+    html_pattern("<A"),
+    html_pattern("<STYLE"),
+    html_pattern("<TITLE"),
+    html_pattern("<B"),
+    html_pattern("<BODY"),
+    html_pattern("<BR"),
+    html_pattern("<P"),
+    html_pattern("<!--"),
+}};
+
+constexpr std::array<byte_pattern, 2> scriptable_patterns{{
+    {"<?xml", "\xFF\xFF\xFF\xFF\xFF", essence_id::text_xml, true},
+    {"%PDF-", "\xFF\xFF\xFF\xFF\xFF", essence_id::application_pdf},
+}};
+
+constexpr std::array<byte_pattern, 4> non_scriptable_patterns{{
+    {"%!PS-Adobe-", "\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF",
+     essence_id::application_postscript},
+    // The UTF-16BE, UTF-16LE and UTF-8 byte order marks.
+    {"\xFE\xFF\0\0"sv, "\xFF\xFF\0\0"sv, essence_id::text_plain},
+    {"\xFF\xFE\0\0"sv, "\xFF\xFF\0\0"sv, essence_id::text_plain},
+    {"\xEF\xBB\xBF\0"sv, "\xFF\xFF\xFF\0"sv, essence_id::text_plain},
+}};
+
+// https://mimesniff.spec.whatwg.org/#matching-an-image-type-pattern
+constexpr std::array<byte_pattern, 8> image_patterns{{
+    {"\0\0\x01\0"sv, "\xFF\xFF\xFF\xFF", essence_id::image_x_icon},
+    {"\0\0\x02\0"sv, "\xFF\xFF\xFF\xFF", essence_id::image_x_icon},
+    {"BM", "\xFF\xFF", essence_id::image_bmp},
+    {"GIF87a", "\xFF\xFF\xFF\xFF\xFF\xFF", essence_id::image_gif},
+    {"GIF89a", "\xFF\xFF\xFF\xFF\xFF\xFF", essence_id::image_gif},
+    {"RIFF\0\0\0\0WEBPVP"sv,
+     "\xFF\xFF\xFF\xFF\0\0\0\0\xFF\xFF\xFF\xFF\xFF\xFF"sv,
+     essence_id::image_webp},
+    {"\x89PNG\r\n\x1A\n", "\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF",
+     essence_id::image_png},
+    {"\xFF\xD8\xFF", "\xFF\xFF\xFF", essence_id::image_jpeg},
+}};
+
+// https://mimesniff.spec.whatwg.org/#matching-an-audio-or-video-type-pattern
+constexpr std::array<byte_pattern, 6> audio_video_patterns{{
+    {"FORM\0\0\0\0AIFF"sv, "\xFF\xFF\xFF\xFF\0\0\0\0\xFF\xFF\xFF\xFF"sv,
+     essence_id::audio_aiff},
+    {"ID3", "\xFF\xFF\xFF", essence_id::audio_mpeg},
+    {"OggS\0"sv, "\xFF\xFF\xFF\xFF\xFF", essence_id::application_ogg},
+    {"MThd\0\0\0\x06"sv, "\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF",
+     essence_id::audio_midi},
+    {"RIFF\0\0\0\0AVI "sv, "\xFF\xFF\xFF\xFF\0\0\0\0\xFF\xFF\xFF\xFF"sv,
+     essence_id::video_avi},
+    {"RIFF\0\0\0\0WAVE"sv, "\xFF\xFF\xFF\xFF\0\0\0\0\xFF\xFF\xFF\xFF"sv,
+     essence_id::audio_wave},
+}};
+
+// https://mimesniff.spec.whatwg.org/#matching-an-archive-type-pattern
+constexpr std::array<byte_pattern, 4> archive_patterns{{
+    {"\x1F\x8B\x08", "\xFF\xFF\xFF", essence_id::application_x_gzip},
+    {"PK\x03\x04", "\xFF\xFF\xFF\xFF", essence_id::application_zip},
+    // RAR 4 and RAR 5.
+    {"Rar!\x1A\x07\0"sv, "\xFF\xFF\xFF\xFF\xFF\xFF\xFF",
+     essence_id::application_x_rar_compressed},
+    {"Rar!\x1A\x07\x01\0"sv, "\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF",
+     essence_id::application_x_rar_compressed},
+}};
+
+// The tables of the rules for identifying an unknown MIME type, in order,
+// with and without the scriptable ones. The HTML rows are matched apart.
+constexpr auto unknown_patterns = concat_patterns(
+    non_scriptable_patterns,
+    concat_patterns(image_patterns,
+                    concat_patterns(audio_video_patterns, archive_patterns)));
+
+constexpr auto image_table = compile_pattern_table(image_patterns);
+static_assert(image_table.max_group_size() <= 2,
+              "a header is compared to at most two image patterns");
+
+/**
+ * The HTML rows compiled into a single lookup. Each tag is followed by its
+ * first tag-terminating byte, but for "<!DOCTYPE HTML" whose first one is the
+ * space. So the offset of the first tag-terminating byte of a header, with
+ * its second and third bytes folded to lowercase by setting 0x20, names the
+ * only row it may match, and a single masked compare tells whether it does.
+ * The fold leaves the bytes other than letters that the rows hold alone.
+ */
+struct html_signature_table {
+  static constexpr size_t size = 32;
+  // One more than the index of the row in html_patterns, or 0.
+  std::array<uint8_t, size> rows{};
+
+  // Only the bytes before the terminator are read: after it, a header may
+  // hold either tag-terminating byte.
+  static constexpr size_t slot(const uint8_t* window,
+                               size_t terminator) noexcept {
+    size_t second = window[1] | 0x20;
+    size_t third = terminator > 2 ? size_t(window[2] | 0x20) : 0;
+    return (second * 6 + third + terminator) % size;
+  }
+};
+
+// Two rows in the same slot fail the build.
+constexpr html_signature_table compile_html_signatures() noexcept {
+  html_signature_table table{};
+  for (size_t i = 0; i < html_patterns.size(); i++) {
+    const byte_pattern& p = html_patterns[i];
+    size_t terminator = 0;
+    while (terminator < p.size &&
+           !is_tag_terminating_byte(p.bytes[terminator])) {
+      terminator++;
+    }
+    size_t slot = html_signature_table::slot(p.bytes, terminator);
+    if (table.rows[slot] != 0) {
+      invalid_byte_pattern();
+    }
+    table.rows[slot] = uint8_t(i + 1);
+  }
+  return table;
+}
+
+constexpr html_signature_table html_signatures = compile_html_signatures();
+
+// The HTML rows on the 16 bytes after the leading whitespace.
+bool matches_html_window(const uint8_t* window) noexcept {
+  if (window[0] != '<') {
+    return false;
+  }
+  size_t terminator = find_tag_terminating_byte(window);
+  if (terminator < 2 || terminator == byte_pattern::max_size) {
+    return false;
+  }
+  size_t row =
+      html_signatures.rows[html_signature_table::slot(window, terminator)];
+  if (row == 0) {
+    return false;
+  }
+  // Every row is shorter than the window, terminator included.
+  const byte_pattern& p = html_patterns[row - 1];
+  return masked_equal(window, p) && is_tag_terminating_byte(window[p.size]);
+}
+
+// The streaming sniffer matches the rows one by one while it is missing
+// some of the 16 bytes.
+constexpr auto html_table = compile_pattern_table(html_patterns);
+constexpr auto audio_video_table = compile_pattern_table(audio_video_patterns);
+constexpr auto unknown_table = compile_pattern_table(unknown_patterns);
+constexpr auto scriptable_unknown_table = compile_pattern_table(
+    concat_patterns(scriptable_patterns, unknown_patterns));
+
+// The formats below are told by their structure rather than by a signature.
+// The header is at most resource_header_size bytes, which bounds every loop:
+// none of them allocates, and each reads a byte at most once.
+
+uint32_t load_u32_be(const uint8_t* bytes) noexcept {
+  return uint32_t(bytes[0]) << 24 | uint32_t(bytes[1]) << 16 |
+         uint32_t(bytes[2]) << 8 | uint32_t(bytes[3]);
+}
+
+// https://mimesniff.spec.whatwg.org/#signature-for-mp4
+bool matches_mp4_signature(const uint8_t* data, size_t length) noexcept {
+  if (length < 12) {
+    return false;
+  }
+  uint32_t box_size = load_u32_be(data);
+  if (length < box_size || box_size % 4 != 0 ||
+      load_u32_be(data + 4) != 0x66747970 /* ftyp */) {
+    return false;
+  }
+  // The major brand, then the compatible brands after the minor version.
+  // Every brand whose first three bytes are "mp4" matches. The brands are
+  // all looked at, so that the loop has no exit that depends on the data.
+  constexpr uint32_t mp4 = 0x6D7034;
+  bool found = (load_u32_be(data + 8) >> 8) == mp4;
+  // The brands are compared as native words, which is a single load each.
+  constexpr uint32_t brand_mask =
+      ADA_MIMESNIFF_IS_BIG_ENDIAN ? 0xFFFFFF00 : 0x00FFFFFF;
+  constexpr uint32_t brand =
+      ADA_MIMESNIFF_IS_BIG_ENDIAN ? mp4 << 8 : 0x34706D;
+  uint32_t matches = 0;
+  for (size_t i = 16; i < box_size; i += 4) {
+    uint32_t word;
+    std::memcpy(&word, data + i, sizeof(word));
+    matches |= uint32_t((word & brand_mask) == brand);
+  }
+  return found || matches != 0;
+}
+
+// The size of the EBML variable-size integer that starts with this byte: one
+// more than its leading zero bits, at most 8 and at most length.
+size_t ebml_vint_size(uint8_t first, size_t length) noexcept {
+  size_t size = 1;
+  for (uint8_t mask = 0x80; size < 8 && size < length && !(first & mask);
+       mask >>= 1) {
+    size++;
+  }
+  return size;
+}
+
+// Where a check on a header stands when only a prefix of it is known.
+enum class rule_state : uint8_t { no, yes, pending };
+
+struct webm_scan {
+  rule_state state;
+  // When pending on the DocType itself: where it starts after its padding,
+  // or where the padding reaches so far.
+  size_t doctype{0};
+};
+
+/**
+ * Runs the WebM check on the first `length` bytes of a header, which may go
+ * on unless `complete`. The result is pending as long as the bytes that
+ * follow can change it.
+ * https://mimesniff.spec.whatwg.org/#signature-for-webm
+ */
+webm_scan scan_webm_signature(const uint8_t* data, size_t length,
+                              bool complete) noexcept {
+  constexpr uint8_t magic[4] = {0x1A, 0x45, 0xDF, 0xA3};
+  constexpr uint8_t doctype[4] = {'w', 'e', 'b', 'm'};
+  constexpr webm_scan no{rule_state::no};
+  constexpr webm_scan more{rule_state::pending};
+  for (size_t i = 0; i < 4; i++) {
+    if (i == length) {
+      return complete ? no : more;
+    }
+    if (data[i] != magic[i]) {
+      return no;
+    }
+  }
+  // The DocType element, 0x42 0x82, is looked for in the first 38 bytes.
+  // The zeroes padding a DocType are skipped once, not again for every
+  // element that starts among them.
+  size_t padding_end = 0;
+  for (size_t iter = 4; iter < 38; iter++) {
+    if (iter >= length) {
+      return complete ? no : more;
+    }
+    if (data[iter] != 0x42) {
+      continue;
+    }
+    if (iter + 1 == length) {
+      if (complete) {
+        continue;
+      }
+      return more;
+    }
+    if (data[iter + 1] != 0x82) {
+      continue;
+    }
+    iter += 2;
+    if (iter >= length) {
+      return complete ? no : more;
+    }
+    size_t size = ebml_vint_size(data[iter], length);
+    if (!complete && size == length) {
+      return more;
+    }
+    iter += size;
+    if (iter >= length - 4) {
+      return complete ? no : more;
+    }
+    // The DocType, "webm", may be padded with leading zero bytes.
+    size_t start = std::max(iter, padding_end);
+    while (start < length && data[start] == 0) {
+      start++;
+    }
+    padding_end = start;
+    size_t known = std::min(length - start, size_t(4));
+    if (std::memcmp(data + start, doctype, known) != 0) {
+      continue;
+    }
+    if (known == 4) {
+      return {rule_state::yes};
+    }
+    if (!complete) {
+      return {rule_state::pending, start};
+    }
+  }
+  return no;
+}
+
+// https://mimesniff.spec.whatwg.org/#match-an-mp3-header
+bool matches_mp3_header(const uint8_t* data, size_t length,
+                        size_t s) noexcept {
+  if (length < s + 4) {
+    return false;
+  }
+  uint8_t b1 = data[s + 1];
+  uint8_t b2 = data[s + 2];
+  // A frame sync, layer III, a bit rate other than "bad" and a known sample
+  // rate.
+  return data[s] == 0xFF && (b1 & 0xE0) == 0xE0 && ((b1 & 0x06) >> 1) == 1 &&
+         (b2 & 0xF0) != 0xF0 && (b2 & 0x0C) != 0x0C;
+}
+
+// https://mimesniff.spec.whatwg.org/#compute-an-mp3-frame-size
+size_t mp3_frame_size(const uint8_t* frame) noexcept {
+  static constexpr uint32_t mp3_rates[16] = {
+      0,      32000,  40000,  48000,  56000,  64000,  80000,  96000,
+      112000, 128000, 160000, 192000, 224000, 256000, 320000, 0};
+  static constexpr uint32_t mp25_rates[16] = {
+      0,     8000,  16000, 24000,  32000,  40000,  48000,  56000,
+      64000, 80000, 96000, 112000, 128000, 144000, 160000, 0};
+  static constexpr uint32_t sample_rates[4] = {44100, 48000, 32000, 0};
+  uint8_t version = (frame[1] & 0x18) >> 3;
+  uint8_t bitrate_index = (frame[2] & 0xF0) >> 4;
+  uint32_t bitrate = (version & 0x01) ? mp3_rates[bitrate_index]
+                                      : mp25_rates[bitrate_index];
+  // The sample rate index was checked by matches_mp3_header.
+  uint32_t frequency = sample_rates[(frame[2] & 0x0C) >> 2];
+  size_t scale = version == 1 ? 72 : 144;
+  size_t padding = (frame[2] & 0x02) >> 1;
+  return size_t(bitrate) * scale / frequency + padding;
+}
+
+// https://mimesniff.spec.whatwg.org/#signature-for-mp3-without-id3
+bool matches_mp3_without_id3_signature(const uint8_t* data,
+                                       size_t length) noexcept {
+  if (!matches_mp3_header(data, length, 0)) {
+    return false;
+  }
+  // The next frame must follow the first one.
+  size_t frame_size = mp3_frame_size(data);
+  return frame_size >= 4 && frame_size <= length &&
+         matches_mp3_header(data, length, frame_size);
+}
+
+// The end of the audio or video type pattern matching algorithm, after the
+// table.
+essence_id match_media_structure(std::string_view header) noexcept {
+  const uint8_t* data = reinterpret_cast<const uint8_t*>(header.data());
+  if (matches_mp4_signature(data, header.size())) {
+    return essence_id::video_mp4;
+  }
+  if (scan_webm_signature(data, header.size(), true).state ==
+      rule_state::yes) {
+    return essence_id::video_webm;
+  }
+  if (matches_mp3_without_id3_signature(data, header.size())) {
+    return essence_id::audio_mpeg;
+  }
+  return essence_id::unknown;
+}
+
+std::string_view resource_header_of(std::string_view resource) noexcept {
+  return resource.substr(0, std::min(resource.size(), resource_header_size));
+}
+
+}  // namespace
+
+bool contains_binary_data_bytes(std::string_view resource_header) noexcept {
+  // Bit b is set for the binary data bytes below 0x20: 0x00 to 0x08, 0x0B,
+  // 0x0E to 0x1A and 0x1C to 0x1F.
+  constexpr uint32_t binary_bytes = 0xF7FFC9FF;
+  auto is_binary = [](char c) {
+    uint8_t b = uint8_t(c);
+    return b < 0x20 && ((binary_bytes >> b) & 1);
+  };
+  // Eight bytes at a time, only the words with a byte below 0x20 are looked
+  // at closely: text has few of them, and binary data stops at the first.
+  size_t i = 0;
+  for (; i + 8 <= resource_header.size(); i += 8) {
+    uint64_t word;
+    std::memcpy(&word, resource_header.data() + i, sizeof(word));
+    constexpr uint64_t ones = 0x0101010101010101ull;
+    constexpr uint64_t highs = 0x8080808080808080ull;
+    if (((word - ones * 0x20) & ~word & highs) == 0) {
+      continue;
+    }
+    for (size_t j = i; j < i + 8; j++) {
+      if (is_binary(resource_header[j])) {
+        return true;
+      }
+    }
+  }
+  for (; i < resource_header.size(); i++) {
+    if (is_binary(resource_header[i])) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool matches_html_signature(std::string_view resource_header) noexcept {
+  std::string_view header = resource_header_of(resource_header);
+  size_t start = skip_sniffing_whitespace(header);
+  if (start == header.size()) {
+    return false;
+  }
+  uint8_t padded[byte_pattern::max_size];
+  return matches_html_window(load_pattern_window(header, start, padded));
+}
+
+essence_id match_image_type_pattern(
+    std::string_view resource_header) noexcept {
+  return image_table.match(resource_header);
+}
+
+essence_id match_audio_or_video_type_pattern(
+    std::string_view resource_header) noexcept {
+  std::string_view header = resource_header_of(resource_header);
+  essence_id id = audio_video_table.match(header);
+  return id != essence_id::unknown ? id : match_media_structure(header);
+}
+
+essence_id identify_unknown_mime_type(std::string_view resource_header,
+                                      bool sniff_scriptable) {
+  std::string_view header = resource_header_of(resource_header);
+  if (sniff_scriptable && matches_html_signature(header)) {
+    return essence_id::text_html;
+  }
+  essence_id id = sniff_scriptable ? scriptable_unknown_table.match(header)
+                                   : unknown_table.match(header);
+  // The archive rows come after the media structures in the standard, but
+  // no header can match both: an MP4 box that large does not fit in the
+  // header, and WebM and MP3 start with other bytes.
+  if (id == essence_id::unknown) {
+    id = match_media_structure(header);
+  }
+  if (id != essence_id::unknown) {
+    return id;
+  }
+  return contains_binary_data_bytes(header)
+             ? essence_id::application_octet_stream
+             : essence_id::text_plain;
+}
+
+sniff_status streaming_sniffer::feed(std::string_view chunk) noexcept {
+  if (status_ == sniff_status::decided || complete_) {
+    return status_;
+  }
+  chunk = chunk.substr(0, resource_header_size - length_);
+  const uint8_t* bytes = reinterpret_cast<const uint8_t*>(chunk.data());
+  size_t begin = length_;
+  size_t end = length_ + chunk.size();
+  // Copies the bytes of the chunk that fall in [offset, offset + size) of
+  // the resource.
+  auto capture = [&](uint8_t* out, size_t offset, size_t size) {
+    size_t from = std::max(offset, begin);
+    size_t to = std::min(offset + size, end);
+    if (from < to) {
+      std::memcpy(out + (from - offset), bytes + (from - begin), to - from);
+    }
+  };
+  capture(stash_, 0, stash_size);
+
+  for (size_t i = 0; in_whitespace_ && i < chunk.size(); i++) {
+    in_whitespace_ = is_sniffing_whitespace(bytes[i]);
+    whitespace_ += in_whitespace_;
+  }
+  if (!in_whitespace_ && whitespace_ > 0) {
+    capture(after_whitespace_, whitespace_, sizeof(after_whitespace_));
+  }
+
+  // The MP4 brands after the major one, once the box is known to fit.
+  uint32_t box_size = load_u32_be(stash_);
+  if (end >= 8 && box_size <= resource_header_size &&
+      load_u32_be(stash_ + 4) == 0x66747970 /* ftyp */) {
+    size_t brands_end = std::min(end, size_t(box_size));
+    for (size_t p = std::max(begin, size_t(16)); p < brands_end; p++) {
+      mp4_word_ = mp4_word_ << 8 | bytes[p - begin];
+      mp4_brand_ |= p % 4 == 3 && (mp4_word_ >> 8) == 0x6D7034;
+    }
+  }
+
+  if (end >= 4 && matches_mp3_header(stash_, 4, 0)) {
+    capture(mp3_next_, mp3_frame_size(stash_), sizeof(mp3_next_));
+  }
+
+  // Past the stash, the WebM check can only wait for a DocType that ends
+  // its padding: the DocType elements are all in the first 48 bytes.
+  if (begin < stash_size && end >= stash_size) {
+    webm_scan scan = scan_webm_signature(stash_, stash_size, false);
+    webm_ = scan.state == rule_state::yes  ? webm_check::yes
+            : scan.state == rule_state::no ? webm_check::no
+                                           : webm_check::pending;
+    webm_matched_ = uint8_t(stash_size - scan.doctype);
+  }
+  constexpr uint8_t doctype[4] = {'w', 'e', 'b', 'm'};
+  for (size_t p = std::max(begin, stash_size);
+       p < end && webm_ == webm_check::pending; p++) {
+    uint8_t byte = bytes[p - begin];
+    if (webm_matched_ == 0 && byte == 0) {
+      continue;
+    }
+    if (byte != doctype[webm_matched_]) {
+      webm_ = webm_check::no;
+    } else if (++webm_matched_ == 4) {
+      webm_ = webm_check::yes;
+    }
+  }
+
+  length_ = end;
+  complete_ = length_ == resource_header_size;
+  return evaluate(chunk);
+}
+
+essence_id streaming_sniffer::finish() noexcept {
+  complete_ = true;
+  evaluate({});
+  return result_;
+}
+
+sniff_status streaming_sniffer::decide(essence_id id) noexcept {
+  status_ = sniff_status::decided;
+  result_ = id;
+  bytes_needed_ = 0;
+  return status_;
+}
+
+sniff_status streaming_sniffer::wait(size_t bytes) noexcept {
+  status_ = sniff_status::need_more_bytes;
+  bytes_needed_ = std::max(bytes, size_t(1));
+  return status_;
+}
+
+sniff_status streaming_sniffer::evaluate(std::string_view unscanned) noexcept {
+  if (status_ == sniff_status::decided) {
+    return status_;
+  }
+  // Once undecidable, no signature can match any more.
+  sniff_status status = status_ == sniff_status::undecidable
+                            ? status_
+                            : match_signatures();
+  if (status == sniff_status::decided) {
+    return status;
+  }
+  // The binary data bytes only matter when no signature matches, which is
+  // the rare case: they are not looked for until then.
+  binary_ = binary_ || contains_binary_data_bytes(unscanned);
+  if (status == sniff_status::need_more_bytes) {
+    return status;
+  }
+  if (binary_) {
+    return decide(essence_id::application_octet_stream);
+  }
+  if (complete_) {
+    return decide(essence_id::text_plain);
+  }
+  status_ = sniff_status::undecidable;
+  bytes_needed_ = resource_header_size - length_;
+  return status_;
+}
+
+sniff_status streaming_sniffer::match_signatures() noexcept {
+  if (length_ == 0 && !complete_) {
+    return wait(1);
+  }
+  // The tables, in the order of the standard. No pattern starts with
+  // whitespace, so while the resource is only whitespace, the patterns that
+  // skip it wait for the first other byte and no other can match.
+  auto scriptable = [&](const uint8_t* window, size_t available,
+                        bool skipped_whitespace) {
+    prefix_match html{};
+    if (available == byte_pattern::max_size || complete_) {
+      html.essence = matches_html_window(window) ? essence_id::text_html
+                                                 : essence_id::unknown;
+    } else {
+      html = html_table.match_prefix(window, available, true, false);
+    }
+    if (html.essence != essence_id::unknown || html.bytes_needed != 0) {
+      return html;
+    }
+    return scriptable_unknown_table.match_prefix(
+        window, available, skipped_whitespace, complete_);
+  };
+  prefix_match table{};
+  if (in_whitespace_) {
+    if (sniff_scriptable_ && !complete_) {
+      return wait(1);
+    }
+  } else if (whitespace_ > 0) {
+    if (sniff_scriptable_) {
+      table = scriptable(after_whitespace_,
+                         std::min(length_ - whitespace_, size_t(16)), true);
+    }
+  } else {
+    size_t available = std::min(length_, size_t(16));
+    table = sniff_scriptable_
+                ? scriptable(stash_, available, false)
+                : unknown_table.match_prefix(stash_, available, false,
+                                             complete_);
+  }
+  if (table.essence != essence_id::unknown) {
+    return decide(table.essence);
+  }
+  if (table.bytes_needed != 0) {
+    return wait(table.bytes_needed);
+  }
+
+  // Then the structures, as in match_media_structure. Missing bytes of the
+  // stash are zero, so the box size read is a lower bound.
+  size_t needed = 0;
+  auto mp4 = [&]() {
+    uint32_t box_size = load_u32_be(stash_);
+    size_t known_type = length_ < 4 ? 0 : std::min(length_, size_t(8)) - 4;
+    if (box_size > resource_header_size ||
+        (length_ >= 4 && box_size % 4 != 0) ||
+        std::memcmp(stash_ + 4, "ftyp", known_type) != 0) {
+      return rule_state::no;
+    }
+    size_t full = std::max(size_t(box_size), size_t(12));
+    if (length_ < full) {
+      needed = full - length_;
+      return complete_ ? rule_state::no : rule_state::pending;
+    }
+    bool major = (load_u32_be(stash_ + 8) >> 8) == 0x6D7034;
+    return major || mp4_brand_ ? rule_state::yes : rule_state::no;
+  };
+  auto webm = [&]() {
+    if (length_ < stash_size) {
+      webm_scan scan = scan_webm_signature(stash_, length_, complete_);
+      needed = scan.doctype != 0 ? scan.doctype + 4 - length_ : 1;
+      return scan.state;
+    }
+    needed = size_t(4 - webm_matched_);
+    switch (webm_) {
+      case webm_check::yes:
+        return rule_state::yes;
+      case webm_check::pending:
+        return complete_ ? rule_state::no : rule_state::pending;
+      default:
+        return rule_state::no;
+    }
+  };
+  auto mp3 = [&]() {
+    if (length_ < 4) {
+      needed = 4 - length_;
+      return stash_[0] != 0xFF || complete_ ? rule_state::no
+                                            : rule_state::pending;
+    }
+    if (!matches_mp3_header(stash_, 4, 0)) {
+      return rule_state::no;
+    }
+    size_t next = mp3_frame_size(stash_);
+    if (next < 4 || next + 4 > resource_header_size ||
+        (length_ > next && mp3_next_[0] != 0xFF)) {
+      return rule_state::no;
+    }
+    if (length_ < next + 4) {
+      needed = next + 4 - length_;
+      return complete_ ? rule_state::no : rule_state::pending;
+    }
+    return matches_mp3_header(mp3_next_, 4, 0) ? rule_state::yes
+                                               : rule_state::no;
+  };
+  rule_state state = mp4();
+  essence_id id = essence_id::video_mp4;
+  if (state == rule_state::no) {
+    state = webm();
+    id = essence_id::video_webm;
+  }
+  if (state == rule_state::no) {
+    state = mp3();
+    id = essence_id::audio_mpeg;
+  }
+  if (state == rule_state::yes) {
+    return decide(id);
+  }
+  if (state == rule_state::pending) {
+    return wait(needed);
+  }
+  return sniff_status::undecidable;
+}
+
+}  // namespace ada::mimesniff
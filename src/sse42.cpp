@@ -0,0 +1,172 @@
+#include "ada/mimesniff/portability.h"
+
+#if ADA_MIMESNIFF_IS_X86_64
+
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+#include <immintrin.h>
+
+#include "ada/mimesniff/implementation.h"
+#include "ada/mimesniff/scanner.h"
+#include "ada/mimesniff/util-inl.h"
+#include "ada/mimesniff/util.h"
+
+ADA_MIMESNIFF_TARGET_REGION("sse4.2")
+
+namespace ada::mimesniff::sse42 {
+
+namespace {
+
+inline __m128i load_table(const uint8_t (&table)[16]) {
+  return _mm_loadu_si128(reinterpret_cast<const __m128i*>(table));
+}
+
+inline uint64_t equal_mask(__m128i v, char c) {
+  return uint16_t(_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(c))));
+}
+
+inline bool is_utf8_continuation(uint8_t c) { return (c & 0xC0) == 0x80; }
+
+}  // namespace
+
+class implementation final : public ada::mimesniff::implementation {
+ public:
+  constexpr implementation() noexcept
+      : ada::mimesniff::implementation("sse42", "Intel/AMD SSE4.2",
+                                       instruction_set::sse42, 16) {}
+
+  void classify_structural_block(
+      const char* block, size_t length,
+      structural_masks& masks) const noexcept override {
+    // The last block is padded with zeroes, which belong to no class.
+    char padded[16]{};
+    if (length < 16) {
+      std::memcpy(padded, block, length);
+      block = padded;
+    }
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block));
+    masks.slash = equal_mask(v, '/');
+    masks.semicolon = equal_mask(v, ';');
+    masks.equals = equal_mask(v, '=');
+    masks.quote = equal_mask(v, '"');
+    masks.backslash = equal_mask(v, '\\');
+    masks.whitespace = equal_mask(v, ' ') | equal_mask(v, '\t') |
+                       equal_mask(v, '\r') | equal_mask(v, '\n');
+  }
+
+  uint8_t http_tokens_map(std::string_view view) const noexcept override {
+    const __m128i lower_table = load_table(token_nibble_lookup.lower);
+    const __m128i symbol_table = load_table(token_nibble_lookup.symbol);
+    const __m128i upper_table = load_table(token_nibble_lookup.upper);
+    const __m128i high_table = load_table(token_nibble_lookup.high);
+    const __m128i nibble = _mm_set1_epi8(0x0F);
+    const __m128i zero = _mm_setzero_si128();
+    __m128i any_lower = zero, any_symbol = zero, any_upper = zero,
+            any_other = zero;
+    size_t i = 0;
+    for (; i + 16 <= view.size(); i += 16) {
+      __m128i v =
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(view.data() + i));
+      __m128i low = _mm_and_si128(v, nibble);
+      __m128i high = _mm_shuffle_epi8(
+          high_table, _mm_and_si128(_mm_srli_epi16(v, 4), nibble));
+      __m128i lower = _mm_and_si128(_mm_shuffle_epi8(lower_table, low), high);
+      __m128i symbol =
+          _mm_and_si128(_mm_shuffle_epi8(symbol_table, low), high);
+      __m128i upper = _mm_and_si128(_mm_shuffle_epi8(upper_table, low), high);
+      any_lower = _mm_or_si128(any_lower, lower);
+      any_symbol = _mm_or_si128(any_symbol, symbol);
+      any_upper = _mm_or_si128(any_upper, upper);
+      any_other = _mm_or_si128(
+          any_other,
+          _mm_cmpeq_epi8(_mm_or_si128(_mm_or_si128(lower, symbol), upper),
+                         zero));
+    }
+    uint8_t token = http_tokens_map_scalar(view.substr(i));
+    token |= _mm_testz_si128(any_lower, any_lower) ? 0 : 1;
+    token |= _mm_testz_si128(any_symbol, any_symbol) ? 0 : 2;
+    token |= _mm_testz_si128(any_upper, any_upper) ? 0 : 4;
+    token |= _mm_testz_si128(any_other, any_other) ? 0 : 128;
+    return token;
+  }
+
+  bool contains_only_http_quoted_string_tokens(
+      std::string_view view) const noexcept override {
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i below_space = _mm_set1_epi8(0x1F);
+    const __m128i delete_char = _mm_set1_epi8(0x7F);
+    const __m128i lead_c2 = _mm_set1_epi8(char(0xC2));
+    const __m128i lead_c3 = _mm_set1_epi8(char(0xC3));
+    const __m128i top_bits = _mm_set1_epi8(char(0xC0));
+    const __m128i continuation = _mm_set1_epi8(char(0x80));
+    __m128i previous_lead = _mm_setzero_si128();
+    __m128i error = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 16 <= view.size(); i += 16) {
+      __m128i v =
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(view.data() + i));
+      // U+0009 TAB or U+0020 SPACE to U+007E (~). Bytes above 0x7F are
+      // negative and fail the signed comparison with 0x1F.
+      __m128i ascii =
+          _mm_or_si128(_mm_cmpeq_epi8(v, tab),
+                       _mm_and_si128(_mm_cmpgt_epi8(v, below_space),
+                                     _mm_cmplt_epi8(v, delete_char)));
+      // U+0080 to U+00FF are encoded as C2 or C3 followed by 80 to BF.
+      __m128i lead =
+          _mm_or_si128(_mm_cmpeq_epi8(v, lead_c2), _mm_cmpeq_epi8(v, lead_c3));
+      __m128i cont = _mm_cmpeq_epi8(_mm_and_si128(v, top_bits), continuation);
+      // Every continuation byte follows a lead byte and every lead byte is
+      // followed by a continuation byte.
+      __m128i shifted = _mm_alignr_epi8(lead, previous_lead, 15);
+      error = _mm_or_si128(
+          error, _mm_or_si128(_mm_xor_si128(cont, shifted),
+                              _mm_cmpeq_epi8(
+                                  _mm_or_si128(ascii, _mm_or_si128(lead, cont)),
+                                  _mm_setzero_si128())));
+      previous_lead = lead;
+    }
+    if (!_mm_testz_si128(error, error)) {
+      return false;
+    }
+    // A two-byte sequence may straddle the end of the last vector.
+    if (i > 0 && (uint8_t(view[i - 1]) & 0xFE) == 0xC2) {
+      if (i == view.size() || !is_utf8_continuation(uint8_t(view[i]))) {
+        return false;
+      }
+      i++;
+    }
+    return contains_only_http_quoted_string_tokens_scalar(view.substr(i));
+  }
+
+  bool to_lower_ascii(char* input, size_t length) const noexcept override {
+    // 'A' to 'Z' become -128 to -103 once 0x3F is added, and nothing else
+    // does.
+    const __m128i offset = _mm_set1_epi8(0x3F);
+    const __m128i bound = _mm_set1_epi8(-102);
+    const __m128i case_bit = _mm_set1_epi8(0x20);
+    __m128i non_ascii = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16) {
+      __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i));
+      non_ascii = _mm_or_si128(non_ascii, v);
+      __m128i upper = _mm_cmplt_epi8(_mm_add_epi8(v, offset), bound);
+      v = _mm_or_si128(v, _mm_and_si128(upper, case_bit));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(input + i), v);
+    }
+    bool ascii = to_lower_ascii_scalar(input + i, length - i);
+    return ascii && _mm_movemask_epi8(non_ascii) == 0;
+  }
+};
+
+const ada::mimesniff::implementation& get_implementation() noexcept {
+  static const implementation singleton{};
+  return singleton;
+}
+
+}  // namespace ada::mimesniff::sse42
+
+ADA_MIMESNIFF_UNTARGET_REGION
+
+#endif  // ADA_MIMESNIFF_IS_X86_64
@@ -1,12 +1,1140 @@
 #include "mimesniff.h"
 #include "gtest/gtest.h"
+#include <algorithm>
 #include <cstdlib>
 #include <iostream>
+#include <memory_resource>
+#include <new>
+#include <tuple>
+
+// Counts the calls to the global operator new, for the tests that check that
+// parsing does not allocate.
+static size_t global_allocations = 0;
+
+void* operator new(size_t size) {
+  global_allocations++;
+  if (void* p = std::malloc(size == 0 ? 1 : size)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+// std::pmr::new_delete_resource() may call the aligned form.
+void* operator new(size_t size, std::align_val_t alignment) {
+  global_allocations++;
+  size_t align = size_t(alignment);
+#if defined(_MSC_VER)
+  void* p = _aligned_malloc(size == 0 ? 1 : size, align);
+#else
+  void* p = std::aligned_alloc(align, (size + align) / align * align);
+#endif
+  if (p) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+static void aligned_free(void* p) noexcept {
+#if defined(_MSC_VER)
+  _aligned_free(p);
+#else
+  std::free(p);
+#endif
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { aligned_free(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept {
+  aligned_free(p);
+}
 
 TEST(basic_tests, valid_type_and_subtype) {
   auto r = ada::mimesniff::parse_mime_type("text/plain");
   ASSERT_TRUE(r.has_value());
-  ASSERT_EQ(r->type, "text");
-  ASSERT_EQ(r->subtype, "plain");
+  ASSERT_EQ(r->type(), "text");
+  ASSERT_EQ(r->subtype(), "plain");
+  SUCCEED();
+}
+
+TEST(basic_tests, view_borrows_from_input) {
+  std::string_view input = "text/html; charset=utf-8";
+  auto r = ada::mimesniff::parse_mime_type_view(input);
+  ASSERT_TRUE(r.has_value());
+  ASSERT_EQ(r->type(), "text");
+  ASSERT_EQ(r->subtype(), "html");
+  ASSERT_EQ(r->type().data(), input.data());
+  ASSERT_EQ(r->parameters().size(), 1);
+  ASSERT_EQ(r->get_parameter("charset"), "utf-8");
+  ASSERT_EQ(r->get_parameter("charset")->data(), input.data() + 19);
+  SUCCEED();
+}
+
+TEST(basic_tests, view_owns_modified_components) {
+  std::string input = "TEXT/html; CHARSET=\"utf\\-8\"; a=1; b=2; c=3; d=4";
+  auto r = ada::mimesniff::parse_mime_type_view(input);
+  ASSERT_TRUE(r.has_value());
+  auto copy = *r;
+  ASSERT_EQ(r->to_mimetype().serialized(), copy.serialized());
+  ASSERT_EQ(copy.parameters().size(), 5);
+  r.reset();
+  input.assign(input.size(), 'x');
+  ASSERT_EQ(copy.type(), "text");
+  ASSERT_EQ(copy.get_parameter("charset"), "utf-8");
+  SUCCEED();
+}
+
+TEST(basic_tests, compact_layout) {
+  auto r = ada::mimesniff::parse_mime_type("Text/HTML;Charset=\"utf-8\";a;b=");
+  ASSERT_TRUE(r.has_value());
+  ASSERT_EQ(r->essence(), "text/html");
+  ASSERT_EQ(r->parameters().size(), 1);
+  ASSERT_EQ(r->get_parameter("charset"), "utf-8");
+  ASSERT_EQ(ada::mimesniff::parse_mime_type(" TEXT/Plain ")->heap_usage(), 0);
+  r->set_parameter("charset", "iso-8859-1");
+  r->set_parameter("boundary", "");
+  std::vector<std::pair<std::string_view, std::string_view>> parameters(
+      r->parameters().begin(), r->parameters().end());
+  ASSERT_EQ(parameters.size(), 2);
+  ASSERT_EQ(parameters[0].second, "iso-8859-1");
+  ASSERT_EQ(parameters[1].first, "boundary");
+  ASSERT_EQ(r->serialized(), "text/html;charset=iso-8859-1;boundary=\"\"");
+  SUCCEED();
+}
+
+TEST(basic_tests, pmr_allocates_from_resource) {
+  char arena[256];
+  std::pmr::monotonic_buffer_resource resource(
+      arena, sizeof(arena), std::pmr::null_memory_resource());
+  std::pmr::memory_resource* previous =
+      std::pmr::set_default_resource(std::pmr::null_memory_resource());
+  auto r = ada::mimesniff::parse_mime_type(
+      "multipart/form-data; boundary=\"----WebKitFormBoundary7MA4YWxk\"",
+      &resource);
+  std::pmr::set_default_resource(previous);
+  ASSERT_TRUE(r.has_value());
+  ASSERT_EQ(r->get_allocator().resource(), &resource);
+  ASSERT_EQ(r->get_parameter("boundary"), "----WebKitFormBoundary7MA4YWxk");
+  ASSERT_GT(r->heap_usage(), 0);
+
+  // Past the names kept inline, the duplicate check allocates from the
+  // resource too.
+  std::string many = "text/plain";
+  for (size_t i = 0; i < 12; i++) {
+    many += ";p" + std::to_string(i) + "=" + std::to_string(i);
+  }
+  char many_arena[2048];
+  std::pmr::monotonic_buffer_resource many_resource(
+      many_arena, sizeof(many_arena), std::pmr::null_memory_resource());
+  size_t allocations = global_allocations;
+  auto parsed = ada::mimesniff::parse_mime_type(many, &many_resource);
+  ASSERT_EQ(global_allocations, allocations);
+  ASSERT_TRUE(parsed.has_value());
+  ASSERT_EQ(parsed->parameters().size(), size_t(12));
+
+  // A parser keeps the table of names between calls.
+  ada::mimesniff::parser parser;
+  ASSERT_NE(parser.parse(many), nullptr);
+  allocations = global_allocations;
+  ASSERT_NE(parser.parse(many), nullptr);
+  ASSERT_EQ(global_allocations, allocations);
+  SUCCEED();
+}
+
+TEST(basic_tests, parse_into_reuses_record) {
+  ada::mimesniff::mimetype m;
+  ASSERT_TRUE(ada::mimesniff::parse_mime_type_into(
+      m, "application/vnd.example+json; version=2; profile=\"x\""));
+  size_t usage = m.heap_usage();
+  ASSERT_FALSE(ada::mimesniff::parse_mime_type_into(m, "invalid"));
+  ASSERT_TRUE(m.essence().empty());
+  ASSERT_TRUE(ada::mimesniff::parse_mime_type_into(m, "Text/Plain;a=b"));
+  ASSERT_EQ(m.serialized(), "text/plain;a=b");
+  ASSERT_EQ(m.heap_usage(), usage);
+
+  auto& p = ada::mimesniff::parser::thread_local_instance();
+  const ada::mimesniff::mimetype* r = p.parse("image/png");
+  ASSERT_NE(r, nullptr);
+  ASSERT_EQ(r->essence(), "image/png");
+  ASSERT_EQ(p.parse("image"), nullptr);
+  SUCCEED();
+}
+
+TEST(basic_tests, structural_scanner_matches_find) {
+  std::string input;
+  for (size_t i = 0; i < 300; i++) {
+    input += "ab/;=\"\\ \t\r\nxyz"[(i * 7 + i / 3) % 15];
+  }
+  std::string_view view = input;
+  using ada::mimesniff::structural;
+  for (auto impl : ada::mimesniff::get_available_implementations()) {
+    if (!impl->supported_by_runtime_system()) {
+      continue;
+    }
+    ada::mimesniff::structural_scanner scanner(view, impl);
+    for (size_t from = 0; from <= view.size(); from++) {
+      size_t expected = std::min(view.find_first_of("=\\", from), view.size());
+      ASSERT_EQ(scanner.find(structural::equals | structural::backslash, from),
+                expected)
+          << impl->name();
+      expected = std::min(view.find_first_not_of(" \t\r\n", from), view.size());
+      ASSERT_EQ(scanner.find_not(structural::whitespace, from), expected)
+          << impl->name();
+    }
+  }
+  SUCCEED();
+}
+
+TEST(basic_tests, implementations_match_scalar) {
+  // Every byte value at every offset of a long value, next to a valid
+  // two-byte UTF-8 sequence that may straddle the vector boundaries.
+  for (auto impl : ada::mimesniff::get_available_implementations()) {
+    if (!impl->supported_by_runtime_system()) {
+      continue;
+    }
+    for (size_t offset = 0; offset < 70; offset++) {
+      for (int c = 0; c < 256; c++) {
+        std::string value(140, 'a');
+        value.replace(offset, 2, "\xC3\xA9");
+        value[offset + 7] = char(c);
+        std::string upper = value;
+        upper[offset + 20] = 'Q';
+        std::string_view whole = value;
+        for (std::string_view v : {whole, std::string_view(upper),
+                                   whole.substr(0, offset + 8),
+                                   whole.substr(0, offset + 1)}) {
+          uint8_t token = 0;
+          for (char x : v) {
+            token |= ada::mimesniff::http_tokens_map_table[uint8_t(x)];
+          }
+          ASSERT_EQ(impl->http_tokens_map(v), token) << impl->name();
+          ASSERT_EQ(
+              impl->contains_only_http_quoted_string_tokens(v),
+              ada::mimesniff::contains_only_http_quoted_string_tokens_scalar(v))
+              << impl->name();
+        }
+      }
+    }
+    for (size_t length = 0; length < 150; length++) {
+      std::string ascii, expected;
+      for (size_t i = 0; i < length; i++) {
+        ascii += char(32 + (i * 37) % 95);
+      }
+      expected = ascii;
+      ada::mimesniff::to_lower_ascii_scalar(expected.data(), length);
+      ASSERT_TRUE(impl->to_lower_ascii(ascii.data(), length));
+      ASSERT_EQ(ascii, expected) << impl->name();
+      if (length > 0) {
+        ascii[length / 2] = char(0xE9);
+        ASSERT_FALSE(impl->to_lower_ascii(ascii.data(), length));
+      }
+    }
+  }
+  static_assert(ada::mimesniff::http_tokens_map("Text/PLAIN;charset=utf-8") &
+                    128,
+                "constant evaluation keeps working");
+  SUCCEED();
+}
+
+TEST(basic_tests, force_implementation) {
+  auto active = ada::mimesniff::get_active_implementation();
+  ASSERT_TRUE(active->supported_by_runtime_system());
+  ASSERT_EQ(ada::mimesniff::get_implementation(active->name()), active);
+  ASSERT_EQ(ada::mimesniff::get_implementation("unknown"), nullptr);
+  ASSERT_FALSE(ada::mimesniff::set_active_implementation(nullptr));
+  for (auto impl : ada::mimesniff::get_available_implementations()) {
+    if (!ada::mimesniff::set_active_implementation(impl)) {
+      ASSERT_FALSE(impl->supported_by_runtime_system());
+      continue;
+    }
+    ASSERT_EQ(ada::mimesniff::get_active_implementation(), impl);
+    auto r = ada::mimesniff::parse_mime_type(
+        "Multipart/Form-Data; Boundary=\"----WebKitFormBoundary\\\"7MA4YWxk\"");
+    ASSERT_TRUE(r.has_value());
+    ASSERT_EQ(r->serialized(),
+              "multipart/form-data;"
+              "boundary=\"----WebKitFormBoundary\\\"7MA4YWxk\"");
+  }
+  ASSERT_TRUE(ada::mimesniff::set_active_implementation(active));
+  SUCCEED();
+}
+
+TEST(basic_tests, parse_batch) {
+  std::vector<std::string> storage;
+  for (size_t i = 0; i < 150; i++) {
+    storage.push_back(i % 3 == 0 ? "text/" + std::to_string(i) + "; a=\"b\""
+                                 : i % 3 == 1 ? "Invalid" + std::to_string(i)
+                                              : "IMAGE/PNG;Q=" +
+                                                    std::to_string(i));
+  }
+  std::vector<std::string_view> inputs(storage.begin(), storage.end());
+  std::vector<ada::mimesniff::mimetype> results(inputs.size());
+  std::vector<uint64_t> valid((inputs.size() + 63) / 64, ~uint64_t(0));
+  // Twice, to check that records and bitmap words are reused correctly.
+  for (int pass = 0; pass < 2; pass++) {
+    size_t count = ada::mimesniff::parse_mime_types(
+        inputs.data(), inputs.size(), results.data(), valid.data());
+    ASSERT_EQ(count, 100);
+    for (size_t i = 0; i < inputs.size(); i++) {
+      auto expected = ada::mimesniff::parse_mime_type(inputs[i]);
+      ASSERT_EQ(bool(valid[i / 64] >> (i % 64) & 1), expected.has_value());
+      if (expected) {
+        ASSERT_EQ(results[i].serialized(), expected->serialized());
+      }
+    }
+  }
+  SUCCEED();
+}
+
+TEST(basic_tests, parse_batch_parallel) {
+  std::vector<std::string> storage;
+  for (size_t i = 0; i < 5000; i++) {
+    storage.push_back(i % 5 == 0 ? "Invalid" : "text/plain;n=" +
+                                                   std::to_string(i));
+  }
+  std::vector<std::string_view> inputs(storage.begin(), storage.end());
+  std::vector<ada::mimesniff::mimetype> results(inputs.size());
+  std::vector<uint64_t> valid((inputs.size() + 63) / 64);
+  ada::mimesniff::thread_pool pool(4);
+  ASSERT_EQ(ada::mimesniff::parse_mime_types_parallel(
+                inputs.data(), inputs.size(), results.data(), valid.data(),
+                pool),
+            4000);
+  for (size_t i = 0; i < inputs.size(); i++) {
+    ASSERT_EQ(bool(valid[i / 64] >> (i % 64) & 1), i % 5 != 0);
+    if (i % 5 != 0) {
+      ASSERT_EQ(results[i].serialized(), inputs[i]);
+    }
+  }
+  // A user executor that runs the tasks in reverse order.
+  size_t tasks = 0;
+  ada::mimesniff::executor reverse =
+      [&tasks](size_t count, const std::function<void(size_t)>& task) {
+        tasks = count;
+        for (size_t i = count; i-- > 0;) {
+          task(i);
+        }
+      };
+  ASSERT_EQ(ada::mimesniff::parse_mime_types_parallel(
+                inputs.data(), inputs.size(), results.data(), valid.data(),
+                reverse),
+            4000);
+  ASSERT_EQ(tasks, (inputs.size() + ada::mimesniff::parallel_chunk_size - 1) /
+                       ada::mimesniff::parallel_chunk_size);
+  SUCCEED();
+}
+
+TEST(basic_tests, thread_pool_runs_every_task_once) {
+  ada::mimesniff::thread_pool pool(3);
+  ASSERT_EQ(pool.thread_count(), 3);
+  for (size_t task_count : {0, 1, 2, 7, 1000}) {
+    std::vector<std::atomic<int>> runs(task_count);
+    pool.run(task_count, [&runs](size_t i) {
+      // Uneven tasks, so that ranges get stolen.
+      if (i % 7 == 0) {
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+      }
+      runs[i]++;
+    });
+    for (auto& r : runs) {
+      ASSERT_EQ(r.load(), 1);
+    }
+  }
+  SUCCEED();
+}
+
+TEST(basic_tests, cache_shares_results) {
+  ada::mimesniff::mime_type_cache cache(4, 1);
+  ada::mimesniff::mime_type_cache::session session(cache);
+  auto first = session.parse("Text/HTML;Charset=\"utf-8\"");
+  auto second = session.parse("Text/HTML;Charset=\"utf-8\"");
+  ASSERT_TRUE(first);
+  ASSERT_EQ(first, second);
+  ASSERT_EQ(first->serialized(), "text/html;charset=utf-8");
+  // Invalid inputs are cached as well.
+  ASSERT_EQ(session.parse("invalid"), nullptr);
+  ASSERT_EQ(session.parse("invalid"), nullptr);
+  auto stats = cache.stats();
+  ASSERT_EQ(stats.hits, 2);
+  ASSERT_EQ(stats.misses, 2);
+  ASSERT_EQ(stats.size, 2);
+
+  // The hot entry survives while cold ones are evicted.
+  for (int i = 0; i < 20; i++) {
+    session.parse("text/plain;n=" + std::to_string(i));
+    ASSERT_EQ(session.parse("Text/HTML;Charset=\"utf-8\""), first);
+  }
+  stats = cache.stats();
+  ASSERT_EQ(stats.size, 4);
+  ASSERT_EQ(stats.evictions, 18);
+  ASSERT_EQ(stats.hits, 22);
+
+  // A record stays valid until the next call on its session, even when
+  // another session evicts it.
+  auto held = session.parse("text/plain;held=1");
+  {
+    ada::mimesniff::mime_type_cache::session other(cache);
+    for (int i = 0; i < 20; i++) {
+      other.parse("text/plain;m=" + std::to_string(i));
+    }
+    other.parse("text/plain;m=0");
+  }
+  ASSERT_EQ(held->serialized(), "text/plain;held=1");
+
+  // The counters of destroyed sessions are kept.
+  stats = cache.stats();
+  ASSERT_EQ(stats.hits + stats.misses, 66);
+
+  // Long inputs are parsed but not cached.
+  std::string long_input = "text/plain;a=" + std::string(2000, 'x');
+  ASSERT_EQ(session.parse(long_input)->get_parameter("a")->size(),
+            size_t(2000));
+  ASSERT_EQ(cache.stats().size, 4);
+
+  cache.clear();
+  ASSERT_EQ(cache.stats().size, 0);
+  ASSERT_EQ(session.parse("Text/HTML;Charset=\"utf-8\"")->serialized(),
+            "text/html;charset=utf-8");
+  SUCCEED();
+}
+
+TEST(basic_tests, cache_concurrent_access) {
+  ada::mimesniff::mime_type_cache cache(64, 4);
+  std::vector<std::thread> threads;
+  std::atomic<size_t> mismatches{0};
+  for (size_t t = 0; t < 4; t++) {
+    threads.emplace_back([&cache, &mismatches, t] {
+      ada::mimesniff::mime_type_cache::session session(cache);
+      for (size_t i = 0; i < 2000; i++) {
+        std::string input = "text/x-" + std::to_string((i * 7 + t) % 100);
+        auto mime = session.parse(input);
+        if (!mime || mime->serialized() != input) {
+          mismatches++;
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  ASSERT_EQ(mismatches.load(), 0);
+  auto stats = cache.stats();
+  ASSERT_EQ(stats.hits + stats.misses, 8000);
+  ASSERT_LE(stats.size, cache.capacity());
+  SUCCEED();
+}
+
+TEST(basic_tests, essence_ids) {
+  using ada::mimesniff::essence_id;
+  auto r = ada::mimesniff::parse_mime_type("Application/JSON; charset=utf-8");
+  ASSERT_TRUE(r.has_value());
+  ASSERT_EQ(r->id(), essence_id::application_json);
+  ASSERT_EQ(ada::mimesniff::parse_mime_type_view(" TEXT/html ")->id(),
+            essence_id::text_html);
+  ASSERT_EQ(ada::mimesniff::mimetype("font", "woff2").id(),
+            essence_id::font_woff2);
+  // Every listed essence has its own id and no prefix or extension of one is
+  // mistaken for it.
+  for (size_t i = 1; i < ada::mimesniff::essence_id_count; i++) {
+    std::string_view essence = ada::mimesniff::essence_names[i];
+    ASSERT_EQ(ada::mimesniff::lookup_essence(essence), essence_id(i));
+    ASSERT_EQ(ada::mimesniff::to_string(essence_id(i)), essence);
+    std::string longer = std::string(essence) + "x";
+    ASSERT_EQ(ada::mimesniff::parse_mime_type(longer)->id(),
+              essence_id::unknown);
+    std::string_view prefix = essence.substr(0, essence.size() - 1);
+    essence_id prefix_id = ada::mimesniff::lookup_essence(prefix);
+    ASSERT_TRUE(prefix_id == essence_id::unknown ||
+                ada::mimesniff::to_string(prefix_id) == prefix);
+  }
+  ASSERT_EQ(ada::mimesniff::parse_mime_type("x/x")->id(), essence_id::unknown);
+  ada::mimesniff::mimetype reused;
+  ASSERT_TRUE(ada::mimesniff::parse_mime_type_into(reused, "image/png"));
+  ASSERT_EQ(reused.id(), essence_id::image_png);
+  ASSERT_FALSE(ada::mimesniff::parse_mime_type_into(reused, "image"));
+  ASSERT_EQ(reused.id(), essence_id::unknown);
+  // The id fits in the padding of the record.
+  static_assert(sizeof(ada::mimesniff::mimetype) == sizeof(std::string) + 16);
+  // The pinned seed is the one the search would find.
+  ASSERT_EQ(ada::mimesniff::make_essence_hash_seed(),
+            ada::mimesniff::essence_hash_table::default_seed);
+  SUCCEED();
+}
+
+TEST(basic_tests, constexpr_parse) {
+  using namespace ada::mimesniff::literals;
+  constexpr auto html =
+      "  Text/HTML;Charset=\"UTF-8\";charset=x;a ; b=\"\\q\" "_mime;
+  static_assert(html.essence() == "text/html");
+  static_assert(html.id() == ada::mimesniff::essence_id::text_html);
+  static_assert(html.parameters().size() == 2);
+  static_assert(html.get_parameter("charset") == "UTF-8");
+  static_assert(
+      html.get_parameter(ada::mimesniff::parameter_name_id::charset) ==
+      "UTF-8");
+  static_assert(html.get_parameter("b") == "q");
+  static_assert(!ada::mimesniff::parse_static_mime_type("text/").has_value());
+  static_assert(
+      !ada::mimesniff::parse_static_mime_type<8>("text/plain").has_value());
+  // A parameter that is dropped takes no room, whatever its size.
+  constexpr auto duplicate = ada::mimesniff::parse_static_mime_type<24>(
+      "text/plain;a=b;A=xxxxxxxxxxxxxxxxxxxxxxxxxxxx");
+  static_assert(duplicate.has_value());
+  static_assert(duplicate->parameters().size() == 1);
+  constexpr auto invalid = ada::mimesniff::parse_static_mime_type<24>(
+      "text/plain;a=b;c=\"xxxxxxxxxxxxxxxxxxxxxxxxxxxx\x01\"");
+  static_assert(invalid.has_value());
+  static_assert(invalid->parameters().size() == 1);
+  ASSERT_EQ(duplicate->serialized(), "text/plain;a=b");
+  ASSERT_EQ(invalid->serialized(), "text/plain;a=b");
+  ASSERT_EQ(html.serialized(), "text/html;charset=UTF-8;b=q");
+  ASSERT_EQ(html.to_mimetype().serialized(), html.serialized());
+  SUCCEED();
+}
+
+TEST(basic_tests, essence_matcher) {
+  constexpr ada::mimesniff::essence_matcher json("Application/JSON");
+  constexpr ada::mimesniff::essence_matcher css("text/css");
+  constexpr ada::mimesniff::essence_matcher xml("a/x+xml");
+  static_assert(json.id() == ada::mimesniff::essence_id::application_json);
+  static_assert(json.matches(" application/JSON \t; charset=utf-8"));
+  static_assert(!json.matches("application/json5"));
+  std::vector<std::string> inputs = {
+      "", "application/json", "  APPLICATION/json  ", "application/json;",
+      "application/json ;x=y", "application/jso", "application/json x",
+      "application/json\v", "application\x0Fjson", "text/css", "TEXT/CSS;",
+      "text/cssx", "text/cs", "text/c-s", "text\rcss", "a/x+xml", "A/X+XML ",
+      "a/x+xm", "a/x+xmL;", "a/x\x0bxml", "\tA/X+XML\r\n"};
+  std::pair<const ada::mimesniff::essence_matcher*, std::string_view>
+      matchers[] = {{&json, "application/json"},
+                    {&css, "text/css"},
+                    {&xml, "a/x+xml"}};
+  for (auto [matcher, essence] : matchers) {
+    for (const std::string& input : inputs) {
+      auto parsed = ada::mimesniff::parse_mime_type(input);
+      bool expected = parsed.has_value() && parsed->essence() == essence;
+      ASSERT_EQ(matcher->matches(input), expected) << input;
+    }
+  }
+  SUCCEED();
+}
+
+TEST(basic_tests, validate_canonical_form) {
+  std::vector<std::string> inputs = {
+      "text/html", "text/html;charset=utf-8", "text/html;charset=\"utf-8\"",
+      "text/html;a=\"\"", "text/html;a=\"b c\"", "text/html;a=b c",
+      "text/html;a=\"\\\"\"", "text/html;a=\"\\\\\"", "text/html;a=\"\\b\"",
+      "text/html;a=\"b", "text/html;a=b;a=c", "text/html;a=\"x;y\";a=c",
+      "text/html;a=\"x;y\";b=c", "text/html;a=\"\\\";b=c\";b=d",
+      "text/html;", "text/html ", " text/html", "Text/html",
+      "text/html;A=b", "text/html;a=b;", "text/html;;a=b", "text/html; a=b",
+      "text/html;a", "text/html;a=", "text/html;a=\"\xC3\xA9\"",
+      "text/html;a=\xC3\xA9", "text/html;a=\"\x01\"", "text/html;a=\x01",
+      "text/html;b=c;a=\"\\\"\";c=d;a=e"};
+  for (const std::string& input : inputs) {
+    auto parsed = ada::mimesniff::parse_mime_type(input);
+    auto result = ada::mimesniff::validate_mime_type(input);
+    ASSERT_EQ(result.valid, parsed.has_value()) << input;
+    ASSERT_EQ(result.canonical, parsed && parsed->serialized() == input)
+        << input;
+  }
+  SUCCEED();
+}
+
+TEST(basic_tests, serialize_to_buffer) {
+  auto r = ada::mimesniff::parse_mime_type(
+      "text/plain;a=\"\\\"q\\\\\";b=\"\";c=tok;d=\"x y\"");
+  ASSERT_TRUE(r.has_value());
+  std::string expected = "text/plain;a=\"\\\"q\\\\\";b=\"\";c=tok;d=\"x y\"";
+  ASSERT_EQ(r->serialized(), expected);
+  ASSERT_EQ(r->serialized_size(), expected.size());
+  char buffer[64];
+  std::fill(std::begin(buffer), std::end(buffer), 'z');
+  // Nothing is written when the buffer is too small.
+  ASSERT_EQ(r->serialize_to(buffer, expected.size() - 1), expected.size());
+  ASSERT_EQ(buffer[0], 'z');
+  ASSERT_EQ(r->serialize_to(buffer, sizeof(buffer)), expected.size());
+  ASSERT_EQ(std::string_view(buffer, expected.size()), expected);
+  ASSERT_EQ(buffer[expected.size()], 'z');
+  std::string header = "Content-Type: ";
+  r->serialize_to(header);
+  ASSERT_EQ(header, "Content-Type: " + expected);
+  auto view = ada::mimesniff::parse_mime_type_view(expected);
+  ASSERT_EQ(view->serialized_size(), expected.size());
+
+  using namespace ada::mimesniff::literals;
+  constexpr auto json = "Application/JSON; Charset=\"utf-8\"; q=\"a b\""_mime;
+  static_assert(json.serialized_size() ==
+                sizeof("application/json;charset=utf-8;q=\"a b\"") - 1);
+  SUCCEED();
+}
+
+TEST(basic_tests, canonicalize_in_place_with_edit) {
+  std::vector<std::string> inputs = {
+      "text/html",
+      " Text/HTML ; Charset=\"UTF-8\" ; a=\"b\\\"c\"",
+      "text/plain;a=1;charset=x;charset=y;b=\"\\\\\"",
+      "text/plain;charset=\"\x01\";charset=utf-8",
+      "text/plain;CHARSET=\"\";x=\"\\\\\\\"\";charset=z",
+      "text/plain;a=\"\\\xC3\xA9\";b=\"\xC3\\\xA9\";b=c",
+      "text/plain;b=\"\\a\\b\\c\\d\";a=\"\"\"\";b=e"};
+  std::vector<ada::mimesniff::parameter_edit> edits = {
+      {},
+      {"charset", "utf-8"},
+      {"charset", "with \"quotes\" and \\"},
+      {"charset", ""},
+      {"charset", std::nullopt},
+      {"b", std::nullopt},
+      {"b", "x"}};
+  for (const std::string& input : inputs) {
+    for (const auto& edit : edits) {
+      auto parsed = ada::mimesniff::parse_mime_type(input);
+      ASSERT_TRUE(parsed.has_value());
+      std::vector<std::pair<std::string_view, std::string_view>> parameters;
+      bool found = false;
+      for (const auto& p : parsed->parameters()) {
+        if (!edit.name.empty() && p.first == edit.name) {
+          found = true;
+          if (edit.value) {
+            parameters.emplace_back(p.first, *edit.value);
+          }
+        } else {
+          parameters.push_back(p);
+        }
+      }
+      if (!found && !edit.name.empty() && edit.value) {
+        parameters.emplace_back(edit.name, *edit.value);
+      }
+      std::string expected = ada::mimesniff::serialize_mime_type(
+          parsed->type(), parsed->subtype(), parameters);
+
+      std::string buffer = input;
+      buffer.resize(std::max(expected.size() + 1, input.size()), '#');
+      auto length = ada::mimesniff::canonicalize_in_place(
+          buffer.data(), input.size(), buffer.size(), edit);
+      ASSERT_EQ(length, expected.size()) << input;
+      ASSERT_EQ(buffer.substr(0, *length), expected) << input;
+
+      // When the result is one byte short of fitting, the buffer is left
+      // untouched.
+      if (expected.size() <= input.size()) {
+        continue;
+      }
+      buffer = input;
+      buffer.resize(expected.size() - 1, '#');
+      std::string copy = buffer;
+      length = ada::mimesniff::canonicalize_in_place(
+          buffer.data(), input.size(), buffer.size(), edit);
+      ASSERT_FALSE(length.has_value()) << input;
+      ASSERT_EQ(buffer, copy);
+    }
+  }
+  char invalid[] = "text/plain";
+  ASSERT_FALSE(ada::mimesniff::canonicalize_in_place(
+      invalid, 10, 64, {"Charset", "x"}));
+  ASSERT_FALSE(ada::mimesniff::canonicalize_in_place(
+      invalid, 10, 64, {"charset", "\x01"}));
+  ASSERT_FALSE(ada::mimesniff::canonicalize_in_place(invalid, 5, 64));
+  SUCCEED();
+}
+
+TEST(basic_tests, lazy_parameters) {
+  std::string input =
+      " Text/X-Custom ; A=1 ; b=\"\x01\" ; B=\"x\\\"y\" ; a=2 ; charset=UTF-8";
+  auto lazy = ada::mimesniff::parse_mime_type_lazy(input);
+  ASSERT_TRUE(lazy.has_value());
+  ASSERT_EQ(lazy->essence(), "text/x-custom");
+  ASSERT_EQ(lazy->type(), "text");
+  ASSERT_EQ(lazy->subtype(), "x-custom");
+  ASSERT_EQ(lazy->id(), ada::mimesniff::essence_id::unknown);
+
+  std::vector<std::pair<std::string, std::string>> parameters;
+  for (const auto& p : lazy->parameters()) {
+    parameters.emplace_back(p.name(), p.value());
+  }
+  std::vector<std::pair<std::string, std::string>> expected = {
+      {"a", "1"}, {"b", "x\"y"}, {"charset", "UTF-8"}};
+  ASSERT_EQ(parameters, expected);
+
+  auto b = lazy->get_parameter("b");
+  ASSERT_TRUE(b.has_value());
+  ASSERT_EQ(b->raw_name(), "B");
+  ASSERT_TRUE(b->escaped());
+  ASSERT_EQ(b->raw_value(), "x\\\"y");
+  ASSERT_EQ(b->value(), "x\"y");
+  ASSERT_FALSE(lazy->get_parameter("c").has_value());
+
+  // A well-known essence is not copied, whatever its case.
+  auto html = ada::mimesniff::parse_mime_type_lazy("TEXT/html;charset=x");
+  ASSERT_TRUE(html.has_value());
+  ASSERT_EQ(html->id(), ada::mimesniff::essence_id::text_html);
+  ASSERT_EQ(html->essence().data(),
+            ada::mimesniff::to_string(html->id()).data());
+  ASSERT_EQ(html->get_parameter("charset")->raw_value(), "x");
+
+  ASSERT_FALSE(ada::mimesniff::parse_mime_type_lazy("text/ html").has_value());
+
+  // ^ and ~ differ by 0x20 but are not letters, so both are yielded, under
+  // and over the names kept in the iterator.
+  std::string many = "text/plain;a^=1;a~=2;A~=3";
+  for (size_t i = 0; i < 12; i++) {
+    many += ";p" + std::to_string(i) + "=1";
+  }
+  many += ";z^=1;z~=2;Z~=3";
+  auto many_lazy = ada::mimesniff::parse_mime_type_lazy(many);
+  std::vector<std::string> names;
+  for (const auto& p : many_lazy->parameters()) {
+    names.push_back(p.name());
+  }
+  ASSERT_EQ(names.size(), size_t(16));
+  ASSERT_EQ(names[1], "a~");
+  ASSERT_EQ(names[15], "z~");
+
+  // A copy goes on from where it was made, on its own.
+  auto it = many_lazy->parameters().begin();
+  for (size_t i = 0; i < 12; i++) {
+    ++it;
+  }
+  auto copy = it;
+  size_t left = 0;
+  for (; it != many_lazy->parameters().end(); ++it) {
+    left++;
+  }
+  for (; copy != many_lazy->parameters().end(); ++copy) {
+    left--;
+  }
+  ASSERT_EQ(left, size_t(0));
+  SUCCEED();
+}
+
+TEST(basic_tests, collect_http_quoted_string_view) {
+  // Long enough for the boundaries to fall in later blocks of the scanner.
+  std::string boundary(100, '-');
+  boundary += "WebKitFormBoundary7MA4YWxkTrZu0gW";
+  // The input, the value and what is left of the input.
+  std::vector<std::tuple<std::string, std::string, std::string>> cases = {
+      {"\"\"", "", ""},
+      {"\"abc\"rest", "abc", "rest"},
+      {"\"abc", "abc", ""},
+      {"\"" + boundary + "\";x", boundary, ";x"},
+      {"\"a\\\"b\\\\c\"rest", "a\"b\\c", "rest"},
+      {"\"" + boundary + "\\\"\"", boundary + "\"", ""},
+      {"\"abc\\", "abc\\", ""},
+      {"\"\\", "\\", ""}};
+  for (const auto& [input, expected, rest] : cases) {
+    std::string_view view = input;
+    std::string storage;
+    std::string_view value =
+        ada::mimesniff::collect_http_quoted_string_view(view, storage);
+    ASSERT_EQ(value, expected) << input;
+    ASSERT_EQ(view, rest) << input;
+    // Only a value with escapes is copied.
+    bool escaped = input.find('\\') != std::string::npos;
+    ASSERT_EQ(value.data() == storage.data(), escaped) << input;
+
+    std::string_view copy_view = input;
+    ASSERT_EQ(ada::mimesniff::collect_http_quoted_string(copy_view), expected);
+    ASSERT_EQ(copy_view, rest);
+  }
+  SUCCEED();
+}
+
+TEST(basic_tests, many_parameters) {
+  // Enough parameters for the duplicate check to switch to a hash set, with
+  // duplicates in another case and invalid values in between.
+  std::string input = "text/plain";
+  std::vector<std::pair<std::string, std::string>> expected;
+  for (size_t i = 0; i < 100; i++) {
+    std::string name = "p" + std::to_string(i % 40);
+    if (i % 3 == 0) {
+      input += ";" + name + "=\"\x01\"";
+      continue;
+    }
+    input += ";" + (i % 2 ? name : "P" + name.substr(1)) + "=" +
+             std::to_string(i);
+    bool duplicate = false;
+    for (const auto& p : expected) {
+      duplicate = duplicate || p.first == name;
+    }
+    if (!duplicate) {
+      expected.emplace_back(name, std::to_string(i));
+    }
+  }
+  std::string serialized =
+      ada::mimesniff::serialize_mime_type("text", "plain", expected);
+
+  auto parsed = ada::mimesniff::parse_mime_type(input);
+  ASSERT_TRUE(parsed.has_value());
+  ASSERT_EQ(parsed->serialized(), serialized);
+  auto view = ada::mimesniff::parse_mime_type_view(input);
+  ASSERT_TRUE(view.has_value());
+  ASSERT_EQ(view->serialized(), serialized);
+  auto lazy = ada::mimesniff::parse_mime_type_lazy(input);
+  ASSERT_TRUE(lazy.has_value());
+  std::vector<std::pair<std::string, std::string>> parameters;
+  for (const auto& p : lazy->parameters()) {
+    parameters.emplace_back(p.name(), p.value());
+  }
+  ASSERT_EQ(parameters, expected);
+  std::string buffer = input;
+  auto length = ada::mimesniff::canonicalize_in_place(
+      buffer.data(), input.size(), buffer.size());
+  ASSERT_EQ(buffer.substr(0, length.value()), serialized);
+  ASSERT_TRUE(ada::mimesniff::validate_mime_type(serialized).canonical);
+  ASSERT_FALSE(ada::mimesniff::validate_mime_type(serialized + ";p1=x")
+                   .canonical);
+
+  // Limits.
+  ada::mimesniff::parse_options options{};
+  ASSERT_TRUE(ada::mimesniff::parse_mime_type(input, options).has_value());
+  options.max_parameters = 100;
+  ASSERT_TRUE(ada::mimesniff::parse_mime_type(input, options).has_value());
+  options.max_parameters = 99;
+  ASSERT_FALSE(ada::mimesniff::parse_mime_type(input, options).has_value());
+  options = {};
+  options.max_length = input.size();
+  ASSERT_TRUE(ada::mimesniff::parse_mime_type(input, options).has_value());
+  options.max_length = input.size() - 1;
+  ASSERT_FALSE(ada::mimesniff::parse_mime_type(input, options).has_value());
+
+  // Names are only folded on ASCII letters: ^ and ~ differ by 0x20 but are
+  // distinct, both inline and in the hash set.
+  for (size_t count : {size_t(2), size_t(20)}) {
+    std::string names = "text/plain";
+    for (size_t i = 0; i + 2 < count; i++) {
+      names += ";n" + std::to_string(i) + "=1";
+    }
+    names += ";a^=1;a~=2;A~=3";
+    std::string canonical = names.substr(0, names.size() - 5);
+    auto names_parsed = ada::mimesniff::parse_mime_type(names);
+    ASSERT_EQ(names_parsed->serialized(), canonical) << count;
+    ASSERT_EQ(ada::mimesniff::parse_mime_type_view(names)->serialized(),
+              canonical);
+    ASSERT_EQ(ada::mimesniff::parse_static_mime_type(names)->serialized(),
+              canonical);
+    ASSERT_TRUE(ada::mimesniff::validate_mime_type(canonical).canonical);
+    std::string names_buffer = names;
+    auto names_length = ada::mimesniff::canonicalize_in_place(
+        names_buffer.data(), names.size(), names_buffer.size());
+    ASSERT_EQ(names_buffer.substr(0, names_length.value()), canonical);
+  }
+  SUCCEED();
+}
+
+TEST(basic_tests, parameter_name_atoms) {
+  using ada::mimesniff::parameter_name_id;
+  for (size_t i = 1; i < ada::mimesniff::parameter_name_id_count; i++) {
+    std::string_view name = ada::mimesniff::parameter_names[i];
+    ASSERT_EQ(ada::mimesniff::lookup_parameter_name(name),
+              parameter_name_id(i));
+  }
+  ASSERT_EQ(ada::mimesniff::lookup_parameter_name("BOUNDARY"),
+            parameter_name_id::boundary);
+  ASSERT_EQ(ada::mimesniff::lookup_parameter_name("boundar"),
+            parameter_name_id::unknown);
+  ASSERT_EQ(ada::mimesniff::lookup_parameter_name("qq"),
+            parameter_name_id::unknown);
+
+  std::string_view input =
+      "multipart/form-data;BOUNDARY=x;q=1;charsets=a;Charset=\"u\\tf\"";
+  std::string_view expected =
+      "multipart/form-data;boundary=x;q=1;charsets=a;charset=utf";
+  auto parsed = ada::mimesniff::parse_mime_type(input);
+  ASSERT_TRUE(parsed.has_value());
+  ASSERT_EQ(parsed->serialized(), expected);
+  ASSERT_EQ(parsed->get_parameter(parameter_name_id::charset), "utf");
+  ASSERT_EQ(parsed->get_parameter("charset"), "utf");
+  ASSERT_EQ(parsed->get_parameter("charsets"), "a");
+  ASSERT_EQ(parsed->get_parameter(parameter_name_id::boundary), "x");
+  ASSERT_FALSE(parsed->get_parameter(parameter_name_id::codecs).has_value());
+  parsed->set_parameter("codecs", "avc1");
+  parsed->set_parameter("charset", "x");
+  ASSERT_EQ(parsed->get_parameter(parameter_name_id::codecs), "avc1");
+  ASSERT_EQ(parsed->get_parameter(parameter_name_id::charset), "x");
+
+  auto view = ada::mimesniff::parse_mime_type_view(input);
+  ASSERT_EQ(view->serialized(), expected);
+  ASSERT_EQ(view->get_parameter(parameter_name_id::charset), "utf");
+
+  auto fixed = ada::mimesniff::parse_static_mime_type(input);
+  ASSERT_EQ(fixed->serialized(), expected);
+  ASSERT_EQ(fixed->get_parameter(parameter_name_id::q), "1");
+
+  auto lazy = ada::mimesniff::parse_mime_type_lazy(input);
+  ASSERT_EQ(lazy->get_parameter("boundary")->name_id(),
+            parameter_name_id::boundary);
+  SUCCEED();
+}
+
+TEST(basic_tests, identify_unknown_mime_type) {
+  using ada::mimesniff::essence_id;
+  using namespace std::string_view_literals;
+  std::vector<std::tuple<std::string_view, bool, essence_id>> cases = {
+      {"  \n<!DOCTYPE html><p>", true, essence_id::text_html},
+      {"<!doctype HTML>", true, essence_id::text_html},
+      {"<!DOCTYPE htm>", true, essence_id::text_plain},
+      {"<html", true, essence_id::text_plain},
+      {"<HTML ", true, essence_id::text_html},
+      {"<p>hello", true, essence_id::text_html},
+      {"<p>hello", false, essence_id::text_plain},
+      {"<!-- x -->", true, essence_id::text_html},
+      {"\t<?xml version=\"1.0\"?>", true, essence_id::text_xml},
+      {"<?XML", true, essence_id::text_plain},
+      {"%PDF-1.7", true, essence_id::application_pdf},
+      {" %PDF-1.7", true, essence_id::text_plain},
+      {"%!PS-Adobe-3.0", false, essence_id::application_postscript},
+      {"\xEF\xBB\xBFhello", false, essence_id::text_plain},
+      {"\xFE\xFF\0h"sv, false, essence_id::text_plain},
+      {"\x89PNG\r\n\x1A\n\0\0\0\rIHDR"sv, true, essence_id::image_png},
+      {"\xFF\xD8\xFF\xE0", false, essence_id::image_jpeg},
+      {"GIF89a", false, essence_id::image_gif},
+      {"GIF89", false, essence_id::text_plain},
+      {"RIFF\x10\0\0\0WEBPVP8 "sv, false, essence_id::image_webp},
+      {"RIFF\x10\0\0\0WAVEfmt "sv, false, essence_id::audio_wave},
+      {"RIFF\x10\0\0\0AVI LIST"sv, false, essence_id::video_avi},
+      {"\0\0\x01\0\x01\0"sv, false, essence_id::image_x_icon},
+      {"BM", false, essence_id::image_bmp},
+      {"ID3\x04", false, essence_id::audio_mpeg},
+      {"OggS\0\x02"sv, false, essence_id::application_ogg},
+      {"PK\x03\x04\x14\0"sv, false, essence_id::application_zip},
+      {"\x1F\x8B\x08\0"sv, false, essence_id::application_x_gzip},
+      {"Rar!\x1A\x07\0"sv, false, essence_id::application_x_rar_compressed},
+      {"plain text\r\n", false, essence_id::text_plain},
+      {"", false, essence_id::text_plain},
+      {"text\x1B[0m", false, essence_id::text_plain},
+      {"bin\x01", false, essence_id::application_octet_stream},
+  };
+  for (const auto &[header, scriptable, expected] : cases) {
+    ASSERT_EQ(ada::mimesniff::identify_unknown_mime_type(header, scriptable),
+              expected)
+        << header;
+  }
+
+  // Only the resource header is looked at.
+  std::string long_text(ada::mimesniff::resource_header_size, 'a');
+  long_text += '\x01';
+  ASSERT_EQ(ada::mimesniff::identify_unknown_mime_type(long_text, false),
+            essence_id::text_plain);
+  SUCCEED();
+}
+
+TEST(basic_tests, matches_html_signature) {
+  using namespace std::string_view_literals;
+  std::vector<std::pair<std::string_view, bool>> cases = {
+      {"<!DOCTYPE HTML>", true},
+      {"<!doctype html ", true},
+      {"<!DocType Html\n", false},
+      {"<!DOCTYPE>", false},
+      {"\r\n\t <ScRiPt>", true},
+      {"<iframe src", true},
+      {"<h1>", true},
+      {"<h2>", false},
+      {"<H1", false},
+      {"<div>", true},
+      {"<font ", true},
+      {"<table>", true},
+      {"<title>", true},
+      {"<tablet>", false},
+      {"<a href", true},
+      {"<A>", true},
+      {"<a", false},
+      {"<b>", true},
+      {"<br>", true},
+      {"<body>", true},
+      {"<bx>", false},
+      {"<p>", true},
+      {"<!-- x", true},
+      {"<!--x", false},
+      {"<style>", true},
+      {"<head>", true},
+      {"<html>", true},
+      // The case fold only applies to letters: 0x08 and 0x1E fold to "("
+      // and ">", and 0x01 to "!".
+      {"<\x08>"sv, false},
+      {"<b\x1E"sv, false},
+      {"<\x01--\x20"sv, false},
+      {"<\0\0\0"sv, false},
+      {"<?xml ", false},
+      {"x<p>", false},
+      {"   ", false},
+      {"", false},
+  };
+  for (const auto &[header, expected] : cases) {
+    ASSERT_EQ(ada::mimesniff::matches_html_signature(header), expected)
+        << header;
+  }
+  SUCCEED();
+}
+
+TEST(basic_tests, match_image_type_pattern) {
+  using ada::mimesniff::essence_id;
+  using namespace std::string_view_literals;
+  std::vector<std::pair<std::string_view, essence_id>> cases = {
+      {"\x89PNG\r\n\x1A\n"sv, essence_id::image_png},
+      {"\x89PNG\r\n\x1A"sv, essence_id::unknown},
+      {" \x89PNG\r\n\x1A\n"sv, essence_id::unknown},
+      {"\xFF\xD8\xFF"sv, essence_id::image_jpeg},
+      {"\xFF\xD8\xFE"sv, essence_id::unknown},
+      {"GIF87a", essence_id::image_gif},
+      {"GIF89a\x01\0\x01\0"sv, essence_id::image_gif},
+      {"GIF88a", essence_id::unknown},
+      {"gif89a", essence_id::unknown},
+      {"RIFF\xFF\xFF\xFF\xFFWEBPVP8L"sv, essence_id::image_webp},
+      {"RIFF\0\0\0\0WEBPV"sv, essence_id::unknown},
+      {"BM\x3E\0"sv, essence_id::image_bmp},
+      {"\0\0\x01\0"sv, essence_id::image_x_icon},
+      {"\0\0\x02\0\x01\0"sv, essence_id::image_x_icon},
+      {"\0\0\x03\0"sv, essence_id::unknown},
+      {"<svg", essence_id::unknown},
+      {"", essence_id::unknown},
+  };
+  for (const auto &[header, expected] : cases) {
+    ASSERT_EQ(ada::mimesniff::match_image_type_pattern(header), expected)
+        << header;
+  }
+  SUCCEED();
+}
+
+TEST(basic_tests, match_audio_or_video_type_pattern) {
+  using ada::mimesniff::essence_id;
+  using ada::mimesniff::match_audio_or_video_type_pattern;
+  using namespace std::string_view_literals;
+
+  std::string mp4(
+      "\0\0\0\x18" "ftypisom\0\0\x02\0" "isommp41\0\0\0\x08" "free"sv);
+  ASSERT_EQ(match_audio_or_video_type_pattern(mp4), essence_id::video_mp4);
+  // The box does not fit in the header.
+  ASSERT_EQ(match_audio_or_video_type_pattern(mp4.substr(0, 20)),
+            essence_id::unknown);
+  std::string m4a = mp4;
+  m4a.replace(20, 4, "M4A ");
+  ASSERT_EQ(match_audio_or_video_type_pattern(m4a), essence_id::unknown);
+  ASSERT_EQ(match_audio_or_video_type_pattern(
+                "\0\0\0\x0C" "ftypmp42"sv),
+            essence_id::video_mp4);
+
+  std::string webm(
+      "\x1A\x45\xDF\xA3\x9F\x42\x86\x81\x01\x42\xF7\x81\x01\x42\xF2\x81\x04"
+      "\x42\xF3\x81\x08\x42\x82\x84webm\x42\x87"sv);
+  ASSERT_EQ(match_audio_or_video_type_pattern(webm), essence_id::video_webm);
+  std::string padded_webm = webm;
+  padded_webm.replace(23, 1, "\x86\0\0"sv);
+  ASSERT_EQ(match_audio_or_video_type_pattern(padded_webm),
+            essence_id::video_webm);
+  std::string matroska = webm;
+  matroska.replace(24, 4, "mkvx");
+  ASSERT_EQ(match_audio_or_video_type_pattern(matroska), essence_id::unknown);
+
+  // Two MPEG-1 layer III frames at 128 kbit/s and 44.1 kHz, 417 bytes each.
+  std::string mp3(834, '\0');
+  mp3.replace(0, 4, "\xFF\xFB\x90\x64");
+  mp3.replace(417, 4, "\xFF\xFB\x90\x64");
+  ASSERT_EQ(match_audio_or_video_type_pattern(mp3), essence_id::audio_mpeg);
+  ASSERT_EQ(match_audio_or_video_type_pattern(mp3.substr(0, 420)),
+            essence_id::unknown);
+  std::string layer2 = mp3;
+  layer2[1] = '\xFD';
+  ASSERT_EQ(match_audio_or_video_type_pattern(layer2), essence_id::unknown);
+
+  ASSERT_EQ(match_audio_or_video_type_pattern("ID3\x03"),
+            essence_id::audio_mpeg);
+  ASSERT_EQ(match_audio_or_video_type_pattern("MThd\0\0\0\x06"sv),
+            essence_id::audio_midi);
+  ASSERT_EQ(match_audio_or_video_type_pattern("\x89PNG\r\n\x1A\n"),
+            essence_id::unknown);
+  ASSERT_EQ(ada::mimesniff::identify_unknown_mime_type(mp4, false),
+            essence_id::video_mp4);
+  ASSERT_EQ(ada::mimesniff::identify_unknown_mime_type(webm, false),
+            essence_id::video_webm);
+  SUCCEED();
+}
+
+TEST(basic_tests, streaming_sniffer) {
+  using ada::mimesniff::essence_id;
+  using ada::mimesniff::sniff_status;
+  using ada::mimesniff::streaming_sniffer;
+  using namespace std::string_literals;
+  using namespace std::string_view_literals;
+
+  std::vector<std::string> headers = {
+      "<!DOCTYPE html><p>",
+      std::string(100, ' ') + "<script>x</script>",
+      "  \t",
+      "<?xml version=\"1.0\"?>",
+      "%PDF-1.7",
+      "\x89PNG\r\n\x1A\n\0\0\0\rIHDR"s,
+      "GIF89a",
+      "RIFF\x10\0\0\0WEBPVP8 "s,
+      "Rar!\x1A\x07\x01\0"s,
+      "plain text\r\n",
+      "bin\x01",
+      "",
+  };
+  // An MP4 whose brand is past the first 64 bytes.
+  std::string mp4(200, '\0');
+  mp4.replace(0, 8, "\0\0\0\xC8" "ftyp"sv);
+  mp4.replace(8, 4, "isom");
+  mp4.replace(180, 4, "mp41");
+  headers.push_back(mp4);
+  mp4.replace(180, 4, "isom");
+  headers.push_back(mp4);
+  // A WebM whose DocType padding runs past the first 64 bytes.
+  std::string webm = "\x1A\x45\xDF\xA3\x9F"s + std::string(25, '\x01') +
+                     "\x42\x82\x84"s + std::string(40, '\0') + "webm\x42\x87";
+  headers.push_back(webm);
+  webm.replace(73, 4, "mkvx");
+  headers.push_back(webm);
+  std::string mp3(834, 'x');
+  mp3.replace(0, 4, "\xFF\xFB\x90\x64");
+  mp3.replace(417, 4, "\xFF\xFB\x90\x64");
+  headers.push_back(mp3);
+  mp3[417] = 'x';
+  headers.push_back(mp3);
+
+  for (const std::string &header : headers) {
+    for (bool scriptable : {false, true}) {
+      essence_id expected =
+          ada::mimesniff::identify_unknown_mime_type(header, scriptable);
+      // A byte at a time: no decision may be taken too early.
+      streaming_sniffer bytes(scriptable);
+      for (char c : header) {
+        if (bytes.feed(std::string_view(&c, 1)) == sniff_status::decided) {
+          ASSERT_EQ(bytes.result(), expected) << header;
+        }
+        if (bytes.status() == sniff_status::undecidable) {
+          ASSERT_TRUE(expected == essence_id::text_plain ||
+                      expected == essence_id::application_octet_stream);
+        }
+      }
+      ASSERT_EQ(bytes.finish(), expected) << header;
+      ASSERT_EQ(bytes.status(), sniff_status::decided);
+      // In two chunks, split anywhere.
+      for (size_t split = 0; split <= header.size(); split++) {
+        streaming_sniffer chunks(scriptable);
+        chunks.feed(std::string_view(header).substr(0, split));
+        chunks.feed(std::string_view(header).substr(split));
+        ASSERT_EQ(chunks.finish(), expected) << header << " at " << split;
+      }
+    }
+  }
+
+  // Decisions on the first packet.
+  streaming_sniffer png(false);
+  ASSERT_EQ(png.feed("\x89PNG\r\n\x1A\n"), sniff_status::decided);
+  ASSERT_EQ(png.result(), essence_id::image_png);
+  streaming_sniffer gif(false);
+  ASSERT_EQ(gif.feed("GIF8"), sniff_status::need_more_bytes);
+  ASSERT_EQ(gif.bytes_needed(), 2);
+  ASSERT_EQ(gif.feed("9a"), sniff_status::decided);
+  ASSERT_EQ(gif.result(), essence_id::image_gif);
+  streaming_sniffer text(true);
+  ASSERT_EQ(text.feed("hello"), sniff_status::undecidable);
+  ASSERT_EQ(text.bytes_needed(), ada::mimesniff::resource_header_size - 5);
+  ASSERT_EQ(text.feed("\x01"), sniff_status::decided);
+  ASSERT_EQ(text.result(), essence_id::application_octet_stream);
+  streaming_sniffer html(true);
+  ASSERT_EQ(html.feed("   "), sniff_status::need_more_bytes);
+  ASSERT_EQ(html.feed("<b>"), sniff_status::decided);
+  ASSERT_EQ(html.result(), essence_id::text_html);
   SUCCEED();
 }
@@ -48,6 +48,70 @@ TEST(wpt_tests, generated_mime_types) {
         if (!has_null_output) {
           ASSERT_EQ(out->serialized(), output);
         }
+
+        auto view = ada::mimesniff::parse_mime_type_view(input);
+
+        ASSERT_EQ(view.has_value(), !has_null_output);
+
+        if (!has_null_output) {
+          ASSERT_EQ(view->serialized(), output);
+        }
+
+        auto validation = ada::mimesniff::validate_mime_type(input);
+
+        ASSERT_EQ(validation.valid, !has_null_output);
+        ASSERT_EQ(validation.canonical, !has_null_output && input == output);
+
+        // Canonicalizing in place gives the serialization, and leaves the
+        // buffer alone when it does not fit.
+        std::string buffer(input);
+        buffer.resize(2 * input.size() + 2);
+        auto length = ada::mimesniff::canonicalize_in_place(
+            buffer.data(), input.size(), buffer.size());
+
+        ASSERT_EQ(length.has_value(), !has_null_output);
+
+        if (!has_null_output) {
+          ASSERT_EQ(std::string_view(buffer.data(), *length), output);
+        }
+
+        buffer.assign(input);
+        auto tight = ada::mimesniff::canonicalize_in_place(
+            buffer.data(), input.size(), input.size());
+
+        if (!has_null_output && output.size() <= input.size()) {
+          ASSERT_EQ(tight, output.size());
+          ASSERT_EQ(std::string_view(buffer.data(), *tight), output);
+        } else {
+          ASSERT_FALSE(tight.has_value());
+          ASSERT_EQ(buffer, input);
+        }
+
+        // The constexpr parser, run at runtime on the same inputs.
+        auto fixed = ada::mimesniff::parse_static_mime_type<1024>(input);
+
+        ASSERT_EQ(fixed.has_value(), !has_null_output);
+
+        if (!has_null_output) {
+          ASSERT_EQ(fixed->serialized(), output);
+        }
+
+        // The lazy parser yields the same parameters, on demand.
+        auto lazy = ada::mimesniff::parse_mime_type_lazy(input);
+
+        ASSERT_EQ(lazy.has_value(), !has_null_output);
+
+        if (!has_null_output) {
+          std::vector<std::pair<std::string, std::string>> parameters;
+          for (const auto &p : lazy->parameters()) {
+            parameters.emplace_back(p.name(), p.value());
+            ASSERT_EQ(lazy->get_parameter(p.name())->raw_value(),
+                      p.raw_value());
+          }
+          ASSERT_EQ(ada::mimesniff::serialize_mime_type(
+                        lazy->type(), lazy->subtype(), parameters),
+                    output);
+        }
       }
     }
   } catch (simdjson::simdjson_error &error) {
@@ -85,6 +149,70 @@ TEST(wpt_tests, mime_types) {
         if (!has_null_output) {
           ASSERT_EQ(out->serialized(), output);
         }
+
+        auto view = ada::mimesniff::parse_mime_type_view(input);
+
+        ASSERT_EQ(view.has_value(), !has_null_output);
+
+        if (!has_null_output) {
+          ASSERT_EQ(view->serialized(), output);
+        }
+
+        auto validation = ada::mimesniff::validate_mime_type(input);
+
+        ASSERT_EQ(validation.valid, !has_null_output);
+        ASSERT_EQ(validation.canonical, !has_null_output && input == output);
+
+        // Canonicalizing in place gives the serialization, and leaves the
+        // buffer alone when it does not fit.
+        std::string buffer(input);
+        buffer.resize(2 * input.size() + 2);
+        auto length = ada::mimesniff::canonicalize_in_place(
+            buffer.data(), input.size(), buffer.size());
+
+        ASSERT_EQ(length.has_value(), !has_null_output);
+
+        if (!has_null_output) {
+          ASSERT_EQ(std::string_view(buffer.data(), *length), output);
+        }
+
+        buffer.assign(input);
+        auto tight = ada::mimesniff::canonicalize_in_place(
+            buffer.data(), input.size(), input.size());
+
+        if (!has_null_output && output.size() <= input.size()) {
+          ASSERT_EQ(tight, output.size());
+          ASSERT_EQ(std::string_view(buffer.data(), *tight), output);
+        } else {
+          ASSERT_FALSE(tight.has_value());
+          ASSERT_EQ(buffer, input);
+        }
+
+        // The constexpr parser, run at runtime on the same inputs.
+        auto fixed = ada::mimesniff::parse_static_mime_type<1024>(input);
+
+        ASSERT_EQ(fixed.has_value(), !has_null_output);
+
+        if (!has_null_output) {
+          ASSERT_EQ(fixed->serialized(), output);
+        }
+
+        // The lazy parser yields the same parameters, on demand.
+        auto lazy = ada::mimesniff::parse_mime_type_lazy(input);
+
+        ASSERT_EQ(lazy.has_value(), !has_null_output);
+
+        if (!has_null_output) {
+          std::vector<std::pair<std::string, std::string>> parameters;
+          for (const auto &p : lazy->parameters()) {
+            parameters.emplace_back(p.name(), p.value());
+            ASSERT_EQ(lazy->get_parameter(p.name())->raw_value(),
+                      p.raw_value());
+          }
+          ASSERT_EQ(ada::mimesniff::serialize_mime_type(
+                        lazy->type(), lazy->subtype(), parameters),
+                    output);
+        }
       }
     }
   } catch (simdjson::simdjson_error &error) {